@@ -3,6 +3,7 @@
 #include "BufferSludgerTransposer.hpp"
 
 #include "Utils.hpp"
+#include "Globals.hpp"
 
 /**
  * This code was taken from JW-Modules at:
@@ -30,7 +31,7 @@ BufferSludger::BufferSludger()
 	configInput(CLEAR_INPUT, "Clear Buffer");
 	configInput(AUDIO_INPUT, "CV Audio Input");
 	configInput(AUDIO_RIGHT_INPUT, "CV Audio Right Input");
-	configInput(AUTOMATION_INPUT, "Playback Automation");
+	configInput(AUTOMATION_INPUT, "Playback Automation (poly channels 2-5 set multitap offsets)");
 	configInput(MIX_INPUT, "Dry/Wet Mix");
 
 	configOutput(AUDIO_OUTPUT, "CV Audio Output");
@@ -42,96 +43,10 @@ BufferSludger::BufferSludger()
 	reset();
 }
 
-void BufferSludger::resizeBuffer(int sampleRate, bool disableSpeed)
-{
-	// Allow up to 16 changes a second to the sampleRate
-	if (lastResizeFrame < sampleRate / 16 && !firstBeat)
-	{
-		return;
-	}
-
-	long sampleCount = static_cast<long>(sampleRate * masterLength);
-	if (sampleCount < 1)
-	{
-		sampleCount = 1;
-	}
-	
-	float speedRatio = 0;
-	if (!samples[0].empty())
-	{
-		speedRatio = static_cast<float>(sampleCount);
-		speedRatio /= samples[0].size();
-	}
-
-	if (this->enableSpeedChange && speedRatio != 0 && !disableSpeed)
-	{
-		resizeBufferSpeed(sampleCount, speedRatio);
-	}
-	else
-	{
-		for (int i = 0; i < 2; ++i)
-		{
-			if (samples[i].size() < samples[i].max_size())
-				samples[i].resize(static_cast<size_t>(sampleCount));
-		}
-	}
-
-	// DEBUG("%d %d", (int)samples[0].size(), (int)samples[1].size());
-
-	lastResizeFrame = 0;
-}
-
-void BufferSludger::resizeBufferSpeed(
-	int sampleRate,
-	float speedRatio)
-{
-	long targetSampleCount = static_cast<long>(sampleRate * masterLength);
-
-	for (int i = 0; i < 2; ++i)
-	{
-		if (samples[i].empty())
-			continue;
-
-		double currentSize = samples[i].size();
-		double speedRatio = static_cast<double>(targetSampleCount);
-		speedRatio /= currentSize;
-
-		// Skip if speed change is too small to be noticeable (<0.5%)
-		if (std::abs(speedRatio - 1.0) < 0.005)
-		{
-			continue;
-		}
-
-		// Resample with linear interpolation (or better algorithm)
-		std::vector<float> resampled(targetSampleCount);
-		for (long n = 0; n < targetSampleCount; ++n)
-		{
-			double oldPos = n / speedRatio;
-			size_t left = static_cast<size_t>(oldPos);
-			size_t right = std::min(left + 1, samples[i].size() - 1);
-			double frac = oldPos - left;
-			resampled[n] =
-				samples[i][left] * (1.0 - frac) +
-				samples[i][right] * frac;
-		}
-
-		samples[i] = std::move(resampled);
-	}
-}
-
-void BufferSludger::reset(bool resetFirstBeat)
-{
-	timeSinceStep = 0.0f;
-	if (resetFirstBeat)
-		firstBeat = true;
-	lastPhaseIn = 0.f;
-	recordingIndex = 0;
-	automationPhase = 0;
-	diffAdd = 0.0;
-}
-
 void BufferSludger::process(const ProcessArgs &args)
 {
+	TRACE_THREAD("Engine");
+	TRACE_SCOPE("BufferSludger::process");
 
 	BufferSludgerTransposer *transposerExtendor = nullptr;
 	if (leftExpander.module)
@@ -150,222 +65,40 @@ void BufferSludger::process(const ProcessArgs &args)
 	}
 	automationMode = (int)(params[MODE_PARAM].getValue()) + 1;
 
-	bool externalBpm = params[EXTERNAL_BPM_PARAM].getValue() > 0.f;
-
-	if (lsampleRate != args.sampleRate)
-	{
-		for (int i = 0; i < 2; ++i)
-			outFilter[i].setCoefficients(20000.9, args.sampleRate);
-	}
-	lsampleRate = args.sampleRate;
-
-	if (inputs[AUDIO_INPUT].isConnected())
-	{
-		isStereo = inputs[AUDIO_RIGHT_INPUT].isConnected();
-	}
-
-	if (clearBufferTrigger.process(inputs[CLEAR_INPUT].getVoltage()))
-	{
-		for (std::vector<float> &vec : samples)
-			std::fill(vec.begin(), vec.end(), 0);
-	}
-
-	if (resetTrigger.process(inputs[RESET_INPUT].getVoltage()))
-	{
-		reset(true);
-	}
-
-	if (!externalBpm && params[BPM_PARAM].getValue() != 0)
-	{
-		this->masterLength = 60 / params[BPM_PARAM].getValue();
-		if (this->masterLength != this->lmasterLength)
-		{
-			resizeBuffer(args.sampleRate);
-		}
-		if (this->masterLength != 0)
-			this->phaseOut += args.sampleTime / this->masterLength;
-	}
-	else if (
-		inputs[STEP_INPUT].isConnected() &&
-		this->masterLength != 0)
-	{
-		if (clockTrigger.process(inputs[STEP_INPUT].getVoltage()))
-		{
-			if (!firstBeat)
-				this->masterLength = timeSinceStep;
-			reset();
-			resizeBuffer(args.sampleRate);
-		}
-		firstBeat = false;
-		if (this->masterLength != 0)
-			this->phaseOut += args.sampleTime / this->masterLength;
-	}
-	else if (inputs[PHASE_INPUT].isConnected())
-	{
-		float dif = fabs(lastPhaseIn - inputs[PHASE_INPUT].getVoltage());
-		if (dif > 0.5)
-		{
-			if (!firstBeat)
-				this->masterLength = timeSinceStep;
-			reset();
-			resizeBuffer(args.sampleRate);
-		}
-		firstBeat = false;
-	}
-	else
-	{
-		reset(true);
-	}
+	SludgerEngine::Input in;
+	in.sampleRate = args.sampleRate;
+	in.sampleTime = args.sampleTime;
 
-	bool skipProcessing = false;
+	in.audio[0] = inputs[AUDIO_INPUT].getVoltage();
+	in.audio[1] = inputs[AUDIO_RIGHT_INPUT].getVoltage();
+	in.audioConnected[0] = inputs[AUDIO_INPUT].isConnected();
+	in.audioConnected[1] = inputs[AUDIO_RIGHT_INPUT].isConnected();
 
-	float automationInput = inputs[AUTOMATION_INPUT].getVoltage();
-	automationInput += this->externalAutomation;
-	automationInput = fmod(fmod(automationInput, 10.0f) + 10.0f, 10.0f);
+	in.automation = inputs[AUTOMATION_INPUT].getVoltage() + this->externalAutomation;
+	in.tapVoltageCount = std::min(inputs[AUTOMATION_INPUT].getChannels() - 1, (int)MAX_TAPS);
+	for (int t = 0; t < in.tapVoltageCount; ++t)
+		in.tapVoltage[t] = inputs[AUTOMATION_INPUT].getVoltage(t + 1);
 
-	if (automationMode == AUTOMATION_MODE_DERIVATIVE)
-	{
-		automationPhase = recordingIndex;
-		automationPhase /= ((float)(samples[0].size()) + GNOME_PLEASING_NUMBER);
-		automationPhase += 2 * (automationInput / 10. - 0.5);
-		// automationPhase = fmod(fmod(automationPhase, 10.0f) + 10.0f, 10.0f);
-	}
-	else if (automationMode == AUTOMATION_MODE_LINEAR)
-	{
-		automationPhase = automationInput / 10.;
-	}
+	in.clear = inputs[CLEAR_INPUT].getVoltage();
+	in.reset = inputs[RESET_INPUT].getVoltage();
 
-	if (automationMode == AUTOMATION_MODE_LINEAR && lastAutomationIn == automationInput)
-	{
-		// output[0] = output[1] = 0.0;
-		// skipProcessing = true;
-	}
+	in.externalBpm = params[EXTERNAL_BPM_PARAM].getValue() > 0.f;
+	in.bpm = params[BPM_PARAM].getValue();
+	in.step = inputs[STEP_INPUT].getVoltage();
+	in.stepConnected = inputs[STEP_INPUT].isConnected();
+	in.phase = inputs[PHASE_INPUT].getVoltage();
+	in.phaseConnected = inputs[PHASE_INPUT].isConnected();
 
-	float time;
-	if (std::isinf(automationPhase) || std::isnan(automationPhase))
-		time = 0.0f;
-	else
-		time = automationPhase * samples[0].size();
- 	// For BufferWidget
-	this->outputIndex = (size_t)time % samples[0].size();
+	in.mix = params[MIX_PARAM].getValue();
+	if (inputs[MIX_INPUT].isConnected())
+		in.mix += inputs[MIX_INPUT].getVoltage();
 
-	// anti clicking filter
-	// change "maxSpeed4Filter" with something better
-	{
-		float indexDif = std::fabs(
-			static_cast<long long>(this->lastOutputIndex) -
-			static_cast<long long>(this->outputIndex));
+	SludgerEngine::process(in);
 
-		if (antiClickFilter && args.sampleRate != 0 &&
-			this->lastOutputIndex != -1 &&
-			indexDif > samples[0].size() / args.sampleRate * maxSpeed4Filter)
-		{
-			fadeGain = 0.0f;
-			fadeCounter = (args.sampleRate / 1000) * this->rampSamplesMs;
-		}
-	}
+	outputs[AUDIO_OUTPUT].setVoltage(filteredOutput[0]);
+	outputs[AUDIO_RIGHT_OUTPUT].setVoltage(filteredOutput[1]);
 
-	for (int i = 0; i < 2; ++i)
-	{
-		std::vector<float> &vec = samples[i];
-		if (!vec.empty() && !skipProcessing)
-		{
-			if (recordingIndex >= (long long)vec.size())
-				recordingIndex = 0;
-
-			int inputId = (i == 0) ? AUDIO_INPUT : AUDIO_RIGHT_INPUT;
-
-			// Record for the buffer
-			if (inputs[inputId].isConnected())
-				vec[recordingIndex] = inputs[inputId].getVoltage();
-
-			switch (this->interpolationMode)
-			{
-			case INTERPOLATION_MODE_OPTIMAL_8X:
-				output[i] = SampleInterpolation::optimal8X(vec, time);
-				break;
-			case INTERPOLATION_MODE_OPTIMAL_2X:
-				output[i] = SampleInterpolation::optimal2X(vec, time);
-				break;
-			case INTERPOLATION_MODE_OPTIMAL_32X:
-				output[i] = SampleInterpolation::optimal32X(vec, time);
-				break;
-			case INTERPOLATION_MODE_CUBIC:
-				output[i] = SampleInterpolation::cubic(vec, time);
-				break;
-			case INTERPOLATION_MODE_LINEAR:
-				output[i] = SampleInterpolation::linear(vec, time);
-				break;
-			case INTERPOLATION_MODE_NONE:
-				output[i] = SampleInterpolation::none(vec, time);
-				break;
-			default:
-				output[i] = 0;
-			}
-		}
-
-		if (fadeCounter > 0)
-		{
-			fadeGain += 1.0f / ((args.sampleRate / 1000) * rampSamplesMs);
-			fadeCounter--;
-			output[i] = (output[i] * fadeGain);
-			output[i] += (lastOutput[i] * (1.0f - fadeGain));
-		}
-	}
-
-	// Update all Last-X variables
-	this->lastPhaseIn = inputs[PHASE_INPUT].getVoltage();
-	this->lastAutomationIn = automationInput;
-	this->lastOutputIndex = this->outputIndex;
-	this->lmasterLength = this->masterLength;
-
-	for (int i = 0; i < 2; ++i)
-		this->lastOutput[i] = output[i];
-
-	// Get the dry output value
-	float dryOutput[2] = {0, 0};
-
-	for (int i = 0; i < 2; ++i)
-	{
-		if (samples[i].size())
-		{
-			float pos =
-				recordingIndex / ((float)(samples[i].size()) + GNOME_PLEASING_NUMBER);
-			dryOutput[i] = samples[i][(size_t)(pos * samples[i].size()) % samples[0].size()];
-		}
-
-		// Mix between dry and wet audio
-		float p = params[MIX_PARAM].getValue();
-		if (inputs[MIX_INPUT].isConnected())
-			p += inputs[MIX_INPUT].getVoltage();
-
-		p = rack::math::clamp(p, 0., 1.);
-		output[i] = p * output[i];
-		output[i] += (1 - p) * dryOutput[i];
-	}
-
-	// Update time/frame
-	timeSinceStep += args.sampleTime;
-	++lastResizeFrame;
-	++recordingIndex;
-
-	if (masterLength != 0)
-		bpmValue = 60 / masterLength;
-
-	if (enableOutputFilter)
-	{
-		outputs[AUDIO_OUTPUT].setVoltage(
-			outFilter[0].process(output[0]));
-		outputs[AUDIO_RIGHT_OUTPUT].setVoltage(
-			outFilter[0].process(output[1]));
-	}
-	else
-	{
-		outputs[AUDIO_OUTPUT].setVoltage(output[0]);
-		outputs[AUDIO_RIGHT_OUTPUT].setVoltage(output[1]);
-	}
-
-	lights[EXTERNAL_BPM_LIGHT].setBrightness(externalBpm ? 10 : 0);
+	lights[EXTERNAL_BPM_LIGHT].setBrightness(in.externalBpm ? 10 : 0);
 	lights[OUTPUT_LIGHT].setBrightness(output[0] != 0.0 ? 10 : 0);
 
 	externalAutomation = 0.0f;
@@ -378,39 +111,10 @@ void BufferSludger::process(const ProcessArgs &args)
 
 void BufferSludger::onReset()
 {
-	bpmValue = -1;
-
-	masterLength = 0.5;
-	timeSinceStep = 0.0;
-	phaseOut = 0.0;
-
-	diffAdd = 0;
-	automationPhase = 0.0;
-
-	lmasterLength = -1;
-	lastPhaseIn = 0.0;
-	lastAutomationIn = 0.0;
-	lautomationPhase = 0.0;
-	lsampleRate = -1;
-
-	antiClickFilter = true;
-	fadeGain = 1.0f;
-	fadeCounter = 0;
-	this->lastOutputIndex = -1;
-	lastOutput[0] = lastOutput[1] = 0;
-	rampSamplesMs = 15;
-
-	firstBeat = true;
+	initialize();
 
 	visualMode = BUFFER_DISPLAY_DRAW_MODE_SAMPLES;
-	automationMode = AUTOMATION_MODE_LINEAR;
-	interpolationMode = INTERPOLATION_MODE_OPTIMAL_8X;
-	enableOutputFilter = true;
-
 	uiDownsampling = 32;
-
-	recordingIndex = 0;
-	this->outputIndex = 0;
 }
 
 void loadWavToSamples(
@@ -419,6 +123,8 @@ void loadWavToSamples(
 	std::vector<float> &rightChannel,
 	bool &isStereo)
 {
+	TRACE_SCOPE("loadWavToSamples");
+
 	drwav wav;
 	if (!drwav_init_file(&wav, filepath.c_str(), nullptr))
 	{
@@ -438,6 +144,8 @@ void loadWavToSamples(
 	isStereo = false;
 	if (wav.channels == 1)
 	{
+		for (float &sample : buffer)
+			sample = std::fmin(sample * AUDIO_VOLTS, 10);
 		rightChannel = buffer;
 		leftChannel = buffer;
 	}
@@ -449,9 +157,9 @@ void loadWavToSamples(
 		for (size_t i = 0; i < numFrames; ++i)
 		{
 			// Left channel
-			leftChannel[i] = std::fmin(buffer[i * 2] * 5, 10);
+			leftChannel[i] = std::fmin(buffer[i * 2] * AUDIO_VOLTS, 10);
 			// Right channel
-			rightChannel[i] = std::fmin(buffer[i * 2 + 1] * 5, 10);
+			rightChannel[i] = std::fmin(buffer[i * 2 + 1] * AUDIO_VOLTS, 10);
 		}
 	}
 
@@ -473,7 +181,10 @@ void BufferSludger::loadWavFile()
 
 	std::string path(pathC);
 
-	loadWavToSamples(path, samples[0], samples[1], isStereo);
+	std::vector<float> leftChannel, rightChannel;
+	loadWavToSamples(path, leftChannel, rightChannel, isStereo);
+	samples[0].assign(std::move(leftChannel));
+	samples[1].assign(std::move(rightChannel));
 
 	reset(true);
 	this->lastOutputIndex = -1;
@@ -484,6 +195,32 @@ void BufferSludger::loadWavFile()
 	resizeBuffer(lsampleRate, true);
 }
 
+void BufferSludger::saveWavFile()
+{
+	static const char FILE_FILTERS[] = "Wave (.wav):wav,WAV";
+
+	if (exporter.isRunning())
+		return;
+
+	osdialog_filters *filters = osdialog_filters_parse(FILE_FILTERS);
+	DEFER({ osdialog_filters_free(filters); });
+
+	char *pathC = osdialog_file(OSDIALOG_SAVE, NULL, "buffer.wav", filters);
+	if (!pathC)
+	{
+		return;
+	}
+
+	std::string path(pathC);
+	std::free(pathC);
+
+	if (system::getExtension(path) != ".wav")
+		path += ".wav";
+
+	int channels = isStereo ? 2 : 1;
+	exporter.start(path, samples[0].size(), channels, lsampleRate > 0 ? lsampleRate : 44100);
+}
+
 // Helper to convert binary data to hex
 std::string bin2hex(const void *data, size_t len)
 {
@@ -543,6 +280,7 @@ json_t *BufferSludger::toJson()
 	// Save int values
 	json_object_set_new(rootJ, "automationMode", json_integer(automationMode));
 	json_object_set_new(rootJ, "interpolationMode", json_integer(interpolationMode));
+	json_object_set_new(rootJ, "spectralMode", json_integer(spectralMode));
 	json_object_set_new(rootJ, "lastResizeFrame", json_integer(lastResizeFrame));
 	json_object_set_new(rootJ, "visualMode", json_integer(visualMode));
 	json_object_set_new(rootJ, "automationMode", json_integer(automationMode));
@@ -557,17 +295,54 @@ json_t *BufferSludger::toJson()
 	json_object_set_new(rootJ, "firstBeat", json_boolean(firstBeat));
 	json_object_set_new(rootJ, "enableOutputFilter", json_boolean(enableOutputFilter));
 	json_object_set_new(rootJ, "enableSpeedChange", json_boolean(enableSpeedChange));
+	json_object_set_new(rootJ, "preservePitch", json_boolean(preservePitch));
+	json_object_set_new(rootJ, "adaptiveQuality", json_boolean(adaptiveQuality));
+	json_object_set_new(rootJ, "tapCount", json_integer(tapCount));
+	json_t *tapsJ = json_array();
+	for (int t = 0; t < MAX_TAPS; ++t)
+	{
+		json_t *tapJ = json_object();
+		json_object_set_new(tapJ, "offset", json_real(tapOffset[t]));
+		json_object_set_new(tapJ, "gain", json_real(tapGain[t]));
+		json_array_append_new(tapsJ, tapJ);
+	}
+	json_object_set_new(rootJ, "taps", tapsJ);
+	json_object_set_new(rootJ, "cpuBudget", json_real(governor.budget));
 	json_object_set_new(rootJ, "antiClickFilter", json_boolean(antiClickFilter));
+	json_object_set_new(rootJ, "enableOverdub", json_boolean(enableOverdub));
+	json_object_set_new(rootJ, "overdubFeedback", json_real(overdubFeedback));
+	json_object_set_new(rootJ, "compactStorage", json_boolean(compactStorage));
 	json_object_set_new(rootJ, "isStereo", json_boolean(isStereo));
 
-	auto saveSamples = [=](std::string title, const std::vector<float> &samples)
+	auto saveSamples = [=](std::string title, const SampleBuffer &buffer)
 	{
+		std::vector<float> samples = buffer.toVector();
 		std::string hex = bin2hex_fast(samples.data(), samples.size() * sizeof(float));
 		json_object_set_new(rootJ, title.c_str(), json_string(hex.c_str()));
 	};
 
-	saveSamples("samples", samples[0]);
-	saveSamples("samplesR", samples[1]);
+	// Compact buffers are saved as int16 with one exponent per chunk
+	auto savePackedSamples = [=](std::string title, const SampleBuffer &buffer)
+	{
+		std::vector<int16_t> pcm;
+		std::vector<int8_t> exponents;
+		buffer.toPacked(pcm, exponents);
+		std::string hex = bin2hex_fast(pcm.data(), pcm.size() * sizeof(int16_t));
+		json_object_set_new(rootJ, (title + "Packed").c_str(), json_string(hex.c_str()));
+		hex = bin2hex_fast(exponents.data(), exponents.size() * sizeof(int8_t));
+		json_object_set_new(rootJ, (title + "Exponents").c_str(), json_string(hex.c_str()));
+	};
+
+	if (compactStorage)
+	{
+		savePackedSamples("samples", samples[0]);
+		savePackedSamples("samplesR", samples[1]);
+	}
+	else
+	{
+		saveSamples("samples", samples[0]);
+		saveSamples("samplesR", samples[1]);
+	}
 
 	return rootJ;
 }
@@ -619,6 +394,14 @@ void BufferSludger::fromJson(json_t *rootJ)
 	if (j)
 		antiClickFilter = json_boolean_value(j);
 
+	j = json_object_get(rootJ, "enableOverdub");
+	if (j)
+		enableOverdub = json_boolean_value(j);
+
+	j = json_object_get(rootJ, "overdubFeedback");
+	if (j)
+		overdubFeedback = math::clamp((float)json_real_value(j), 0.0f, 1.0f);
+
 	j = json_object_get(rootJ, "fadeGain");
 	if (j)
 		fadeGain = json_real_value(j);
@@ -652,6 +435,10 @@ void BufferSludger::fromJson(json_t *rootJ)
 	if (j)
 		automationMode = json_integer_value(j);
 
+	j = json_object_get(rootJ, "spectralMode");
+	if (j)
+		spectralMode = json_integer_value(j);
+
 	j = json_object_get(rootJ, "interpolationMode");
 	if (j)
 		interpolationMode = (int8_t)json_integer_value(j);
@@ -688,20 +475,79 @@ void BufferSludger::fromJson(json_t *rootJ)
 	if (j)
 		enableSpeedChange = json_boolean_value(j);
 
-	auto loadSamples = [=](json_t *j, const std::string &title, std::vector<float> &samples)
+	j = json_object_get(rootJ, "preservePitch");
+	if (j)
+		preservePitch = json_boolean_value(j);
+
+	j = json_object_get(rootJ, "adaptiveQuality");
+	if (j)
+		adaptiveQuality = json_boolean_value(j);
+
+	j = json_object_get(rootJ, "tapCount");
+	if (j)
+		tapCount = math::clamp((int)json_integer_value(j), 0, (int)MAX_TAPS);
+
+	j = json_object_get(rootJ, "taps");
+	if (j && json_is_array(j))
+	{
+		for (int t = 0; t < MAX_TAPS && t < (int)json_array_size(j); ++t)
+		{
+			json_t *tapJ = json_array_get(j, t);
+			json_t *valueJ = json_object_get(tapJ, "offset");
+			if (valueJ)
+				tapOffset[t] = json_real_value(valueJ);
+			valueJ = json_object_get(tapJ, "gain");
+			if (valueJ)
+				tapGain[t] = json_real_value(valueJ);
+		}
+	}
+
+	j = json_object_get(rootJ, "cpuBudget");
+	if (j)
+		governor.budget = math::clamp((float)json_real_value(j), 0.01f, 1.0f);
+
+	auto loadSamples = [=](json_t *j, const std::string &title, SampleBuffer &buffer)
 	{
 		j = json_object_get(rootJ, title.c_str());
 		if (j && json_is_string(j))
 		{
 			const char *hex = json_string_value(j);
 			size_t size = strlen(hex) / (2 * sizeof(float));
-			samples.resize(size);
+			std::vector<float> samples(size);
 			hex2bin(hex, samples.data(), size * sizeof(float));
+			buffer.assign(std::move(samples));
 		}
 	};
 
+	auto loadPackedSamples = [=](json_t *j, const std::string &title, SampleBuffer &buffer)
+	{
+		j = json_object_get(rootJ, (title + "Packed").c_str());
+		json_t *exponentsJ = json_object_get(rootJ, (title + "Exponents").c_str());
+		if (j && json_is_string(j) && exponentsJ && json_is_string(exponentsJ))
+		{
+			const char *hex = json_string_value(j);
+			size_t size = strlen(hex) / (2 * sizeof(int16_t));
+			std::vector<int16_t> pcm(size);
+			hex2bin(hex, pcm.data(), size * sizeof(int16_t));
+
+			hex = json_string_value(exponentsJ);
+			std::vector<int8_t> exponents(strlen(hex) / 2);
+			hex2bin(hex, exponents.data(), exponents.size());
+			buffer.assignPacked(std::move(pcm), exponents);
+		}
+	};
+
+	j = json_object_get(rootJ, "compactStorage");
+	if (j)
+		compactStorage = json_boolean_value(j);
+
+	for (SampleBuffer &buffer : samples)
+		buffer.setCompact(compactStorage);
+
 	loadSamples(j, "samples", samples[0]);
 	loadSamples(j, "samplesR", samples[1]);
+	loadPackedSamples(j, "samples", samples[0]);
+	loadPackedSamples(j, "samplesR", samples[1]);
 }
 
 struct BFInterpolationModeItem : MenuItem
@@ -759,6 +605,33 @@ struct BFVisualModeItem : MenuItem
 	}
 };
 
+struct BFSpectralModeItem : MenuItem
+{
+
+	int *ptrSpectralMode = nullptr;
+
+	Menu *createChildMenu() override
+	{
+		Menu *menu = new Menu;
+
+		menu->addChild(createMenuLabel(string::f("Delays the output by %d samples", SpectralProcessor::LATENCY)));
+		menu->addChild(createCheckMenuItem("Off", "", [=]()
+										   { return *ptrSpectralMode == SPECTRAL_MODE_OFF; }, [=]()
+										   { *ptrSpectralMode = SPECTRAL_MODE_OFF; }));
+		menu->addChild(createCheckMenuItem("Freeze (automation above 5V)", "", [=]()
+										   { return *ptrSpectralMode == SPECTRAL_MODE_FREEZE; }, [=]()
+										   { *ptrSpectralMode = SPECTRAL_MODE_FREEZE; }));
+		menu->addChild(createCheckMenuItem("Blur (automation sets amount)", "", [=]()
+										   { return *ptrSpectralMode == SPECTRAL_MODE_BLUR; }, [=]()
+										   { *ptrSpectralMode = SPECTRAL_MODE_BLUR; }));
+		menu->addChild(createCheckMenuItem("Bin Shift (automation 5V is none)", "", [=]()
+										   { return *ptrSpectralMode == SPECTRAL_MODE_SHIFT; }, [=]()
+										   { *ptrSpectralMode = SPECTRAL_MODE_SHIFT; }));
+
+		return menu;
+	}
+};
+
 struct BFUiDownsamplingQuantity : Quantity
 {
 	float value = 0;
@@ -816,6 +689,189 @@ struct BFUiDownsamplingSlider : ui::Slider
 	}
 };
 
+struct BFOverdubFeedbackQuantity : Quantity
+{
+	float *overdubFeedback = nullptr;
+
+	BFOverdubFeedbackQuantity(float *overdubFeedback)
+	{
+		this->overdubFeedback = overdubFeedback;
+	}
+
+	void setValue(float value) override
+	{
+		*overdubFeedback = math::clamp(value, getMinValue(), getMaxValue());
+	}
+
+	float getValue() override
+	{
+		return *overdubFeedback;
+	}
+
+	float getMinValue() override { return 0; }
+	float getMaxValue() override { return 1; }
+	float getDefaultValue() override { return 0.8f; }
+
+	float getDisplayValue() override
+	{
+		return *overdubFeedback * 100.0f;
+	}
+
+	void setDisplayValue(float displayValue) override
+	{
+		setValue(displayValue / 100.0f);
+	}
+
+	std::string getLabel() override { return "Overdub Feedback"; }
+	std::string getUnit() override { return "%"; }
+};
+
+struct BFOverdubFeedbackSlider : ui::Slider
+{
+	BFOverdubFeedbackSlider(float *overdubFeedback)
+	{
+		quantity = new BFOverdubFeedbackQuantity(overdubFeedback);
+	}
+	~BFOverdubFeedbackSlider()
+	{
+		delete quantity;
+	}
+};
+
+struct BFCpuBudgetQuantity : Quantity
+{
+	float *budget = nullptr;
+
+	BFCpuBudgetQuantity(float *budget)
+	{
+		this->budget = budget;
+	}
+
+	void setValue(float value) override
+	{
+		*budget = math::clamp(value, getMinValue(), getMaxValue());
+	}
+
+	float getValue() override
+	{
+		return *budget;
+	}
+
+	float getMinValue() override { return 0.01f; }
+	float getMaxValue() override { return 1.0f; }
+	float getDefaultValue() override { return 0.05f; }
+
+	float getDisplayValue() override
+	{
+		return *budget * 100.0f;
+	}
+
+	void setDisplayValue(float displayValue) override
+	{
+		setValue(displayValue / 100.0f);
+	}
+
+	std::string getLabel() override { return "CPU Budget"; }
+	std::string getUnit() override { return "%"; }
+};
+
+struct BFCpuBudgetSlider : ui::Slider
+{
+	BFCpuBudgetSlider(float *budget)
+	{
+		quantity = new BFCpuBudgetQuantity(budget);
+	}
+	~BFCpuBudgetSlider()
+	{
+		delete quantity;
+	}
+};
+
+struct BFTapQuantity : Quantity
+{
+	float *value = nullptr;
+	std::string label;
+
+	BFTapQuantity(float *value, std::string label)
+	{
+		this->value = value;
+		this->label = label;
+	}
+
+	void setValue(float value) override
+	{
+		*this->value = math::clamp(value, getMinValue(), getMaxValue());
+	}
+
+	float getValue() override
+	{
+		return *value;
+	}
+
+	float getMinValue() override { return 0; }
+	float getMaxValue() override { return 1; }
+	float getDefaultValue() override { return 0.5f; }
+
+	float getDisplayValue() override
+	{
+		return *value * 100.0f;
+	}
+
+	void setDisplayValue(float displayValue) override
+	{
+		setValue(displayValue / 100.0f);
+	}
+
+	std::string getLabel() override { return label; }
+	std::string getUnit() override { return "%"; }
+};
+
+struct BFTapSlider : ui::Slider
+{
+	BFTapSlider(float *value, std::string label)
+	{
+		quantity = new BFTapQuantity(value, label);
+	}
+	~BFTapSlider()
+	{
+		delete quantity;
+	}
+};
+
+struct BFMultitapItem : MenuItem
+{
+	BufferSludger *module;
+
+	Menu *createChildMenu() override
+	{
+		Menu *menu = new Menu;
+
+		for (int count = 0; count <= BufferSludger::MAX_TAPS; ++count)
+		{
+			std::string text = count == 0 ? "Off" : string::f("%d Taps", count);
+			menu->addChild(createCheckMenuItem(text, "", [=]()
+											   { return module->tapCount == count; }, [=]()
+											   { module->tapCount = count; }));
+		}
+
+		menu->addChild(new MenuSeparator());
+		menu->addChild(createMenuLabel("Offsets are overridden by automation channels 2-5"));
+
+		for (int t = 0; t < module->tapCount; ++t)
+		{
+			ui::Slider *slider = new BFTapSlider(&module->tapOffset[t], string::f("Tap %d Offset", t + 1));
+			slider->box.size.x = 200.0f;
+			menu->addChild(slider);
+
+			slider = new BFTapSlider(&module->tapGain[t], string::f("Tap %d Gain", t + 1));
+			slider->box.size.x = 200.0f;
+			menu->addChild(slider);
+		}
+
+		return menu;
+	}
+};
+
 struct BFUiItem : MenuItem
 {
 	BufferSludger *module;
@@ -840,6 +896,18 @@ struct BFLoadWavItem : MenuItem
 	}
 };
 
+struct BFSaveWavItem : MenuItem
+{
+	BufferSludger *module;
+	void onAction(const event::Action &e) override
+	{
+		if (module)
+		{
+			module->saveWavFile();
+		}
+	}
+};
+
 BufferSludgerWidget::BufferSludgerWidget(BufferSludger *module)
 {
 	setModule(module);
@@ -900,6 +968,20 @@ BufferSludgerWidget::BufferSludgerWidget(BufferSludger *module)
 		bufferDisplayWidget->module = module;
 
 		addChild(bufferDisplayWidget);
+
+		diagnostics = createWidget<DiagnosticsOverlay>(bufferDisplayWidget->box.pos);
+		diagnostics->box.size = bufferDisplayWidget->box.size;
+		diagnostics->collect = [=](std::vector<std::string> &lines)
+		{
+			size_t bytes = module->samples[0].bytes() + module->samples[1].bytes();
+			lines.push_back("Buffer   " + DiagnosticsOverlay::formatBytes(bytes));
+			lines.push_back(string::f("Length   %d samples", (int)module->samples[0].size()));
+			lines.push_back(string::f("Resizes  %d", module->resizeCount));
+			lines.push_back(string::f("Stretch  %s", module->rebuilder.isStretching() ? "running" : "idle"));
+			if (module->adaptiveQuality)
+				lines.push_back(string::f("DSP load %.1f%%", module->governor.load * 100.0f));
+		};
+		addChild(diagnostics);
 	}
 
 	// mm2px(Vec(9.609, 4.101))
@@ -921,6 +1003,13 @@ void BufferSludgerWidget::appendContextMenu(Menu *menu)
 	loadWav->module = dynamic_cast<BufferSludger *>(module);
 	menu->addChild(loadWav);
 
+	BFSaveWavItem *saveWav = new BFSaveWavItem;
+	saveWav->text = "Export Buffer to WAV";
+	saveWav->rightText = module->exporter.isRunning() ? "Exporting" : "";
+	saveWav->disabled = module->exporter.isRunning();
+	saveWav->module = module;
+	menu->addChild(saveWav);
+
 	menu->addChild(new MenuSeparator());
 
 	BFInterpolationModeItem *intrModeItm = nullptr;
@@ -928,6 +1017,23 @@ void BufferSludgerWidget::appendContextMenu(Menu *menu)
 	intrModeItm->ptrInterpolationMode = &(module->interpolationMode);
 	menu->addChild(intrModeItm);
 
+	menu->addChild(createCheckMenuItem("Adaptive Quality", "", [=]()
+									   { return module->adaptiveQuality; }, [=]()
+									   { module->adaptiveQuality ^= 1; }));
+
+	ui::Slider *cpuBudgetSlider = new BFCpuBudgetSlider(&module->governor.budget);
+	cpuBudgetSlider->box.size.x = 200.0f;
+	menu->addChild(cpuBudgetSlider);
+
+	BFMultitapItem *multitapItm = createMenuItem<BFMultitapItem>("Multitap", RIGHT_ARROW);
+	multitapItm->module = module;
+	menu->addChild(multitapItm);
+
+	BFSpectralModeItem *spectralModeItm = nullptr;
+	spectralModeItm = createMenuItem<BFSpectralModeItem>("Spectral Mode", RIGHT_ARROW);
+	spectralModeItm->ptrSpectralMode = &(module->spectralMode);
+	menu->addChild(spectralModeItm);
+
 	menu->addChild(createCheckMenuItem("Disable Output Filter", "", [=]()
 									   { return !module->enableOutputFilter; }, [=]()
 									   { module->enableOutputFilter ^= 1; }));
@@ -940,6 +1046,22 @@ void BufferSludgerWidget::appendContextMenu(Menu *menu)
 									   { return module->enableSpeedChange; }, [=]()
 									   { module->enableSpeedChange ^= 1; }));
 
+	menu->addChild(createCheckMenuItem("Keep pitch on speed change", "", [=]()
+									   { return module->preservePitch; }, [=]()
+									   { module->preservePitch ^= 1; }));
+
+	menu->addChild(createCheckMenuItem("Overdub", "", [=]()
+									   { return module->enableOverdub; }, [=]()
+									   { module->enableOverdub ^= 1; }));
+
+	menu->addChild(createCheckMenuItem("Compact Storage (16 bit)", "", [=]()
+									   { return module->compactStorage; }, [=]()
+									   { module->compactStorage ^= 1; }));
+
+	ui::Slider *overdubFeedbackSlider = new BFOverdubFeedbackSlider(&module->overdubFeedback);
+	overdubFeedbackSlider->box.size.x = 200.0f;
+	menu->addChild(overdubFeedbackSlider);
+
 	menu->addChild(new MenuSeparator());
 
 	BFVisualModeItem *visualModeItm = nullptr;
@@ -951,6 +1073,9 @@ void BufferSludgerWidget::appendContextMenu(Menu *menu)
 	uiDownsamplingSlider = new BFUiDownsamplingSlider(&module->uiDownsampling);
 	uiDownsamplingSlider->box.size.x = 200.0f;
 	menu->addChild(uiDownsamplingSlider);
+
+	appendTraceMenu(menu);
+	appendDiagnosticsMenu(menu, diagnostics);
 }
 
 Model *modelBufferSludger = createModel<BufferSludger, BufferSludgerWidget>("BufferSludger");
@@ -25,6 +25,9 @@ void setModule()
 
 void BufferSludgerTransposer::process(const ProcessArgs& args) 
 {
+	TRACE_THREAD("Engine");
+	TRACE_SCOPE("BufferSludgerTransposer::process");
+
 	BufferSludger* bufferExpander = nullptr;
 
 	if (isDeleting())
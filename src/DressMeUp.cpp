@@ -64,6 +64,9 @@ float DressMeUp::getStepValue(int index)
 
 void DressMeUp::process(const ProcessArgs &args)
 {
+	TRACE_THREAD("Engine");
+	TRACE_SCOPE("DressMeUp::process");
+
 	if ((int)hpFilter.getSampleRate() != args.sampleRate)
 	{
 		hpFilter.setCutoff(args.sampleRate, 100);
@@ -546,6 +549,21 @@ DressMeUpWidget::DressMeUpWidget(DressMeUp *module)
 	dressMeUpDisplay->init(module, pos, size);
 	DressMeUpGLWidget *dmud = dressMeUpDisplay->child;
 
+	diagnostics = createWidget<DiagnosticsOverlay>(pos);
+	diagnostics->box.size = size;
+	diagnostics->collect = [=](std::vector<std::string> &lines)
+	{
+		if (!dmud)
+		{
+			lines.push_back("OpenGL unavailable");
+			return;
+		}
+		lines.push_back(string::f("Textures %d", (int)dmud->textures.size()));
+		lines.push_back("VRAM     ~" + DiagnosticsOverlay::formatBytes(dmud->videoMemoryBytes()));
+		lines.push_back(string::f("Frame    %.2f ms", dmud->lastFrameMs));
+	};
+	addChild(diagnostics);
+
 	if (dmud)
 	{
 		ImageData &imageData = *dmud->loadImage(
@@ -694,6 +712,9 @@ void DressMeUpWidget::appendContextMenu(Menu *menu)
 	menu->addChild(createCheckMenuItem("Enable Output Filter", "", [=]()
 									   { return module->enableOutputFilter; }, [=]()
 									   { module->enableOutputFilter ^= 1; }));
+
+	appendTraceMenu(menu);
+	appendDiagnosticsMenu(menu, diagnostics);
 }
 
 Menu *VisualParamsMenuItem::createChildMenu()
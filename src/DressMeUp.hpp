@@ -1,9 +1,12 @@
 #pragma once
 #include "plugin.hpp"
 #include "widgets/DressMeUpDisplay.hpp"
+#include "widgets/TraceMenu.hpp"
+#include "widgets/DiagnosticsOverlay.hpp"
 #include "utils/ClothingManager.hpp"
 #include "utils/Globals.hpp"
 #include "utils/MathUtils.hpp"
+#include "utils/Trace.hpp"
 
 #include <array>
 
@@ -111,6 +114,7 @@ struct DressMeUpWidget : ModuleWidget
 
 	DressMeUp *module = nullptr;
 	DressMeUpDisplay *dressMeUpDisplay;
+	DiagnosticsOverlay *diagnostics = nullptr;
 
 	DressMeUpWidget(DressMeUp *module);
 
@@ -19,6 +19,8 @@ SortStep::SortStep()
 	configInput(RECALCULATE_INPUT, "Recalculate");
 	configInput(ALGORITHM_INPUT, "Algorithm Select");
 	configInput(ARRAYSIZE_INPUT, "Array Size");
+	configInput(POSITION_INPUT, "Sort Position");
+	configInput(REVERSE_INPUT, "Reverse Sort Gate");
 
 	// configOutput(STEP_OUTPUT, "Step");
 	configOutput(CV_OUTPUT, "Index CV");
@@ -42,6 +44,8 @@ SortStep::SortStep()
 	insertToMap(TRAVERSE_STEP_INPUT);
 	insertToMap(RANDOMIZE_INPUT);
 	insertToMap(RECALCULATE_INPUT);
+
+	positionDivider.setDivision(32);
 }
 
 bool SortStep::checkTrigger(InputId inputId)
@@ -75,8 +79,11 @@ void SortStep::outputEvent(SorterArrayEvent *event)
 	if (!event)
 		return;
 
-	for (SelectedType &element : event->elements)
+	SelectedType elements[2];
+	int elementCount = event->getElements(elements);
+	for (int e = 0; e < elementCount; ++e)
 	{
+		const SelectedType &element = elements[e];
 		auto mapValueOut = [=](int value) -> float
 		{
 			float out;
@@ -443,6 +450,11 @@ void apply(json_t *rootJ, SorterArray &sorter, SorterArrayWidget *sorterScreen)
 
 void SortStep::process(const ProcessArgs &args)
 {
+	TRACE_THREAD("Engine");
+	TRACE_SCOPE("SortStep::process");
+
+	sorterArray.poll();
+
 	if (expander != leftExpander.module)
 	{
 		expander = leftExpander.module;
@@ -556,9 +568,28 @@ void SortStep::process(const ProcessArgs &args)
 	outputs[CV_OUTPUT].setChannels(2);
 	outputs[VALUE_OUTPUT].setChannels(2);
 
+	// 0 to 10V scrubs over the events calculated so far, the steps carry
+	// on from there
+	if (inputs[InputId::POSITION_INPUT].isConnected() && positionDivider.process())
+	{
+		float x = inputs[InputId::POSITION_INPUT].getVoltage();
+		x = math::clamp(x / 10.0f, 0.0f, 1.0f);
+		int position = (int)std::round(x * sorterArray.playableEvents());
+		if (position != lastPosition)
+		{
+			lastPosition = position;
+			outputEvent(sorterArray.seek(position));
+		}
+	}
+
+	// While high the sort steps undo its events, unsorting the array
+	bool reverse = inputs[InputId::REVERSE_INPUT].getVoltage() >= 5.0f;
+
 	if (checkTrigger(STEP_INPUT))
 	{
-		if (!sorterArray.isDone())
+		if (reverse)
+			outputEvent(sorterArray.stepSortBack());
+		else if (!sorterArray.isDone())
 			outputEvent(sorterArray.step());
 	}
 
@@ -571,7 +602,7 @@ void SortStep::process(const ProcessArgs &args)
 	if (checkTrigger(SORT_STEP_INPUT))
 	{
 		// if (!sorter.isDoneSort())
-		outputEvent(sorterArray.stepSort());
+		outputEvent(reverse ? sorterArray.stepSortBack() : sorterArray.stepSort());
 	}
 
 	if (checkTrigger(TRAVERSE_STEP_INPUT))
@@ -685,6 +716,8 @@ SortStepWidget::SortStepWidget(SortStep *module)
 
 	addInput(createInputCentered<PJ301MPort>(mm2px(Vec(xBase + rowE, rowTopY)), module, SortStep::ALGORITHM_INPUT));
 	addInput(createInputCentered<PJ301MPort>(mm2px(Vec(xBase + rowE, rowCentreY)), module, SortStep::ARRAYSIZE_INPUT));
+	addInput(createInputCentered<PJ301MPort>(mm2px(Vec(xBase + rowC * 0.25 + rowD * 0.75, rowBottomY)), module, SortStep::POSITION_INPUT));
+	addInput(createInputCentered<PJ301MPort>(mm2px(Vec(xBase + rowE + 15.5, rowBottomY)), module, SortStep::REVERSE_INPUT));
 
 	float buttonsOffset = 1.f / 3;
 
@@ -704,11 +737,11 @@ SortStepWidget::SortStepWidget(SortStep *module)
 	addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(xBase + rowD, rowCentreY)), module, SortStep::TRAVERSE_END_OUTPUT));
 
 	// addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(xBase + 65, rowBottomY)), module, SortStep::STEP_OUTPUT));
-	addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(xBase + rowD * 0.8 + rowE * 0.2, rowBottomY)), module, SortStep::VALUE_OUTPUT));
+	addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(xBase + rowD * 0.75 + rowE * 0.25, rowBottomY)), module, SortStep::VALUE_OUTPUT));
 	addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(xBase + rowD * 0.2 + rowE * 0.8, rowBottomY)), module, SortStep::CV_OUTPUT));
 
 	// Add scale knob
-	RoundSmallBlackKnob *knob = createParamCentered<RoundSmallBlackKnob>(mm2px(Vec(xBase + rowE + 7.5, rowBottomY)), module, SortStep::SCALE_PARAM);
+	RoundSmallBlackKnob *knob = createParamCentered<RoundSmallBlackKnob>(mm2px(Vec(xBase + rowE + 4.5, rowBottomY)), module, SortStep::SCALE_PARAM);
 	addParam(knob);
 
 	// mm2px(Vec(94.528, 84.528))
@@ -732,6 +765,21 @@ SortStepWidget::SortStepWidget(SortStep *module)
 
 		// widget->updateUIFromState();
 		module->sorterScreen = widget;
+
+		diagnostics = createWidget<DiagnosticsOverlay>(widget->box.pos);
+		diagnostics->box.size = widget->box.size;
+		diagnostics->collect = [=](std::vector<std::string> &lines)
+		{
+			lines.push_back(string::f("Events   %d", (int)sorterArray->eventCount));
+			lines.push_back("Log      " + DiagnosticsOverlay::formatBytes(sorterArray->eventBytes));
+			lines.push_back(string::f("Compute  %.1f ms", (float)sorterArray->lastComputeMs));
+			lines.push_back(string::f("Worker   %s of %d", sorterArray->processingFinished ? "idle" : "running",
+									  WorkerPool::instance().getWorkerCount()));
+			SorterLogCache &cache = SorterLogCache::instance();
+			lines.push_back(string::f("Cache    %d logs, %d hits, ", (int)cache.getCount(), (int)cache.getHits()) +
+							DiagnosticsOverlay::formatBytes(cache.getBytes()));
+		};
+		addChild(diagnostics);
 	}
 	else
 	{
@@ -742,4 +790,28 @@ SortStepWidget::SortStepWidget(SortStep *module)
 	}
 }
 
+void SortStepWidget::appendContextMenu(Menu *menu)
+{
+	// Shared by every SortStep, only for this session
+	if (WorkerPool::isAffinitySupported())
+	{
+		menu->addChild(new MenuSeparator());
+		menu->addChild(createSubmenuItem("Sort Worker Core", "", [](Menu *submenu)
+										 {
+			WorkerPool &pool = WorkerPool::instance();
+			submenu->addChild(createCheckMenuItem("Any", "",
+				[&pool]() { return pool.getAffinity() < 0; },
+				[&pool]() { pool.setAffinity(-1); }));
+			for (int core = 0; core < WorkerPool::getCoreCount(); ++core)
+			{
+				submenu->addChild(createCheckMenuItem(string::f("Core %d", core), "",
+					[&pool, core]() { return pool.getAffinity() == core; },
+					[&pool, core]() { pool.setAffinity(core); }));
+			} }));
+	}
+
+	appendTraceMenu(menu);
+	appendDiagnosticsMenu(menu, diagnostics);
+}
+
 Model *modelSortStep = createModel<SortStep, SortStepWidget>("SortStep");
\ No newline at end of file
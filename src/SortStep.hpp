@@ -2,7 +2,10 @@
 #include "plugin.hpp"
 
 #include "utils/SorterArray.hpp"
+#include "utils/Trace.hpp"
 #include "widgets/SorterArrayScreen.hpp"
+#include "widgets/TraceMenu.hpp"
+#include "widgets/DiagnosticsOverlay.hpp"
 #include <unordered_map>
 
 struct SortStep : Module {
@@ -23,6 +26,8 @@ struct SortStep : Module {
         RECALCULATE_INPUT,
         ALGORITHM_INPUT,
         ARRAYSIZE_INPUT,
+        POSITION_INPUT,
+        REVERSE_INPUT,
         INPUTS_LEN
     };
     enum OutputId {
@@ -46,6 +51,10 @@ struct SortStep : Module {
     dsp::SchmittTrigger randomizeTrigger;
     dsp::SchmittTrigger stepTrigger;
     std::unordered_map<size_t, dsp::SchmittTrigger> triggersMap;
+    // A seek back replays up to a checkpoint interval, the position isn't
+    // read every sample
+    dsp::ClockDivider positionDivider;
+    int lastPosition = -1;
 
     SorterArray sorterArray;
     dsp::PulseGenerator pulseDone;
@@ -77,6 +86,9 @@ struct SortStep : Module {
 struct SortStepWidget : ModuleWidget {
 
     SortStep* module;
+    DiagnosticsOverlay* diagnostics = nullptr;
 
     SortStepWidget(SortStep* module);
+
+    void appendContextMenu(Menu* menu) override;
 };
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "BufferExporter.hpp"
+#include "Globals.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+
+#include "dr_wav.h"
+
+BufferExporter::~BufferExporter()
+{
+	cancel();
+	WorkerPool::instance().wait(job);
+}
+
+bool BufferExporter::start(const std::string &path, size_t length, int channels, unsigned sampleRate)
+{
+	if (state != IDLE || length == 0)
+		return false;
+
+	// The last file may still be closing
+	WorkerPool::instance().wait(job);
+
+	this->path = path;
+	this->sampleRate = sampleRate;
+	snapshot.allocate(length, channels);
+	progress = 0.0f;
+	failed = false;
+
+	// The audio thread starts copying from here on
+	state = SNAPSHOT;
+	return true;
+}
+
+void BufferExporter::process(const std::array<SampleBuffer, 2> &buffers, long recordIndex)
+{
+	if (state != SNAPSHOT)
+		return;
+
+	if (!snapshot.process(buffers, recordIndex))
+	{
+		cancel();
+		return;
+	}
+
+	progress = 0.5f * snapshot.getProgress();
+	if (!snapshot.isComplete())
+		return;
+
+	state = WRITING;
+	job.context = this;
+	job.run = [](WorkerPool::Job &current) {
+		static_cast<BufferExporter *>(current.context)->writeFile();
+	};
+	if (!WorkerPool::instance().submit(job))
+	{
+		failed = true;
+		state = IDLE;
+	}
+}
+
+void BufferExporter::cancel()
+{
+	if (state == SNAPSHOT)
+	{
+		failed = true;
+		state = IDLE;
+	}
+}
+
+void BufferExporter::writeFile()
+{
+	TRACE_SCOPE("BufferExporter::writeFile");
+
+	size_t length = snapshot.getLength();
+	int channels = snapshot.getChannels();
+
+	drwav_data_format format;
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+	format.channels = channels;
+	format.sampleRate = sampleRate;
+	format.bitsPerSample = 32;
+
+	drwav wav;
+	if (!drwav_init_file_write(&wav, path.c_str(), &format, NULL))
+	{
+		snapshot.release();
+		failed = true;
+		state = IDLE;
+		return;
+	}
+
+	const size_t BLOCK = 4096;
+	std::vector<float> interleaved(BLOCK * channels);
+	for (size_t begin = 0; begin < length; begin += BLOCK)
+	{
+		size_t frames = std::min(BLOCK, length - begin);
+		// Written at the same full scale the wav loader reads
+		for (size_t n = 0; n < frames; ++n)
+			for (int c = 0; c < channels; ++c)
+				interleaved[n * channels + c] = std::min(std::max(snapshot.samples[c][begin + n] / AUDIO_VOLTS, -1.0f), 1.0f);
+
+		if (drwav_write_pcm_frames(&wav, frames, interleaved.data()) != frames)
+		{
+			failed = true;
+			break;
+		}
+		progress = 0.5f + 0.5f * (begin + frames) / length;
+	}
+	drwav_uninit(&wav);
+
+	snapshot.release();
+	state = IDLE;
+}
@@ -0,0 +1,63 @@
+#ifndef _BUFFER_EXPORTER
+#define _BUFFER_EXPORTER
+
+#include <array>
+#include <atomic>
+#include <string>
+
+#include "BufferSnapshot.hpp"
+#include "WorkerPool.hpp"
+
+/**
+ * Writes a snapshot of the buffers to a wav file without pausing the
+ * audio thread.
+ *
+ * start() allocates the snapshot, the audio thread then fills it in
+ * process(), see BufferSnapshot, so the file holds the buffer as it was
+ * when the export started. Once every chunk is copied process() submits a
+ * WorkerPool job that encodes the file with dr_wav.
+ */
+struct BufferExporter
+{
+	enum State
+	{
+		IDLE,
+		SNAPSHOT,
+		WRITING
+	};
+
+	std::atomic<int> state{IDLE};
+	// Snapshot is the first half, writing the second
+	std::atomic<float> progress{0.0f};
+	std::atomic<bool> failed{false};
+
+	BufferExporter() {}
+	~BufferExporter();
+
+	BufferExporter(const BufferExporter &) = delete;
+	BufferExporter &operator=(const BufferExporter &) = delete;
+
+	// UI thread, returns false if an export is still running
+	bool start(const std::string &path, size_t length, int channels, unsigned sampleRate);
+
+	// Audio thread, call before the recorder writes at recordIndex
+	void process(const std::array<SampleBuffer, 2> &buffers, long recordIndex);
+
+	bool isRunning() const
+	{
+		return state != IDLE;
+	}
+
+private:
+	std::string path;
+	unsigned sampleRate = 44100;
+
+	BufferSnapshot snapshot;
+	WorkerPool::Job job;
+
+	void cancel();
+
+	void writeFile();
+};
+
+#endif // _BUFFER_EXPORTER
@@ -0,0 +1,273 @@
+#include "BufferRebuilder.hpp"
+#include "TimeStretcher.hpp"
+#include "Trace.hpp"
+
+constexpr int BufferRebuilder::CATCH_UP_CHUNKS;
+
+BufferRebuilder::~BufferRebuilder()
+{
+	job.cancel();
+	WorkerPool::instance().wait(job);
+}
+
+void BufferRebuilder::stretchTo(size_t length, float sampleRate)
+{
+	if (buildStretch && buildLength != length)
+		abandon();
+	stretchLength = length;
+	stretchSampleRate = sampleRate;
+}
+
+void BufferRebuilder::cancelStretch()
+{
+	if (buildStretch)
+		abandon();
+	stretchLength = 0;
+}
+
+bool BufferRebuilder::process(std::array<SampleBuffer, 2> &buffers, long recordIndex)
+{
+	int current = state;
+	if (current == BUILDING)
+		markDirty(recordIndex);
+
+	// Only this thread moves the state on, once the job of the current
+	// one is done with it
+	if (!job.finished)
+		return false;
+	if (job.failed)
+	{
+		// The pool had no room, queued again
+		WorkerPool::instance().submit(job);
+		return false;
+	}
+
+	switch (current)
+	{
+	case IDLE:
+		return start(buffers);
+	case ALLOCATING:
+		state = COPYING;
+		break;
+	case COPYING:
+		if (abandoned || !snapshot.process(buffers, recordIndex))
+		{
+			submit(FREEING);
+			break;
+		}
+		markDirty(recordIndex);
+		if (snapshot.isComplete())
+		{
+			revision[0] = snapshot.getRevision(0);
+			revision[1] = snapshot.getRevision(1);
+			submit(BUILDING);
+		}
+		break;
+	case BUILDING:
+		// A cancelled stretch leaves the built buffers short
+		if (built[0].size() == buildLength && built[1].size() == buildLength)
+			state = READY;
+		else
+			submit(FREEING);
+		break;
+	case READY:
+		return finish(buffers, recordIndex);
+	case FREEING:
+		state = IDLE;
+		break;
+	}
+	return false;
+}
+
+void BufferRebuilder::submit(State next)
+{
+	state = next;
+	WorkerPool::instance().submit(job);
+}
+
+bool BufferRebuilder::start(std::array<SampleBuffer, 2> &buffers)
+{
+	size_t length = buffers[0].size();
+	if (length == 0)
+	{
+		// Nothing to stretch or convert
+		for (SampleBuffer &buffer : buffers)
+		{
+			if (buffer.empty())
+				buffer.setCompact(wantedCompact);
+		}
+		stretchLength = 0;
+		return false;
+	}
+
+	if (stretchLength == length)
+		stretchLength = 0;
+	bool converted = buffers[0].compact == wantedCompact && buffers[1].compact == wantedCompact;
+	// The engine keeps both channels the same length
+	if ((stretchLength == 0 && converted) || buffers[1].size() != length)
+		return false;
+
+	sourceLength = length;
+	buildStretch = stretchLength > 0;
+	buildLength = buildStretch ? stretchLength : length;
+	buildSampleRate = stretchSampleRate;
+	buildCompact = wantedCompact;
+	abandoned = false;
+	if (synchronous)
+		return rebuildNow(buffers);
+
+	job.context = this;
+	job.run = &BufferRebuilder::run;
+	submit(ALLOCATING);
+	return false;
+}
+
+bool BufferRebuilder::rebuildNow(std::array<SampleBuffer, 2> &buffers)
+{
+	TRACE_SCOPE("BufferRebuilder::rebuildNow");
+	snapshot.allocate(sourceLength, 2);
+	while (snapshot.process(buffers, -1) && !snapshot.isComplete())
+		;
+
+	// Left set by a stretch abandoned before, nothing runs the job now
+	job.cancelled = false;
+	build();
+	for (int i = 0; i < 2; ++i)
+		buffers[i].swap(built[i]);
+	release();
+
+	if (buildStretch && stretchLength == buildLength)
+		stretchLength = 0;
+	return buildStretch;
+}
+
+void BufferRebuilder::abandon()
+{
+	int current = state;
+	if (current == IDLE || current == FREEING)
+		return;
+	abandoned = true;
+	job.cancel();
+}
+
+void BufferRebuilder::markDirty(long recordIndex)
+{
+	if (dirty.empty() || recordIndex < 0 || (size_t)recordIndex >= sourceLength)
+		return;
+
+	size_t chunk = (size_t)recordIndex >> SampleBuffer::CHUNK_SHIFT;
+	dirty[chunk] = 1;
+	if (chunk < dirtyCursor)
+		dirtyCursor = chunk;
+}
+
+bool BufferRebuilder::catchUp(const std::array<SampleBuffer, 2> &buffers)
+{
+	int copies = 0;
+	for (; dirtyCursor < dirty.size(); ++dirtyCursor)
+	{
+		if (!dirty[dirtyCursor])
+			continue;
+		if (copies == CATCH_UP_CHUNKS)
+			return false;
+
+		for (int i = 0; i < 2; ++i)
+		{
+			// Stored as heard now, in the live buffer's epoch and pass
+			built[i].epoch = buffers[i].epoch;
+			built[i].pass = buffers[i].pass;
+			buffers[i].readChunk(dirtyCursor, buffers[i].version(), heard.data());
+			built[i].assignChunk(dirtyCursor, heard.data());
+		}
+		dirty[dirtyCursor] = 0;
+		++copies;
+	}
+	return true;
+}
+
+bool BufferRebuilder::finish(std::array<SampleBuffer, 2> &buffers, long recordIndex)
+{
+	// Resized or replaced since the snapshot, the result is out of date
+	if (abandoned || buffers[0].revision != revision[0] || buffers[1].revision != revision[1])
+	{
+		submit(FREEING);
+		return false;
+	}
+
+	// The recorder's chunk is copied in the call that swaps
+	markDirty(recordIndex);
+	if (!catchUp(buffers))
+		return false;
+
+	TRACE_SCOPE("BufferRebuilder::swap");
+	for (int i = 0; i < 2; ++i)
+		buffers[i].swap(built[i]);
+	if (buildStretch && stretchLength == buildLength)
+		stretchLength = 0;
+	submit(FREEING);
+	return buildStretch;
+}
+
+void BufferRebuilder::run(WorkerPool::Job &job)
+{
+	BufferRebuilder *rebuilder = static_cast<BufferRebuilder *>(job.context);
+	switch (rebuilder->state)
+	{
+	case ALLOCATING:
+		rebuilder->allocate();
+		break;
+	case BUILDING:
+		rebuilder->build();
+		break;
+	case FREEING:
+		rebuilder->release();
+		break;
+	}
+}
+
+void BufferRebuilder::allocate()
+{
+	TRACE_SCOPE("BufferRebuilder::allocate");
+	snapshot.allocate(sourceLength, 2);
+	if (!buildStretch)
+	{
+		size_t chunks = (sourceLength + SampleBuffer::CHUNK_SIZE - 1) >> SampleBuffer::CHUNK_SHIFT;
+		dirty.assign(chunks, 0);
+		dirtyCursor = chunks;
+		heard.resize(SampleBuffer::CHUNK_SIZE);
+	}
+}
+
+void BufferRebuilder::build()
+{
+	TRACE_SCOPE("BufferRebuilder::build");
+	for (int i = 0; i < 2; ++i)
+	{
+		std::vector<float> samples;
+		if (!buildStretch)
+			samples.swap(snapshot.samples[i]);
+		else if (!TimeStretcher::stretch(snapshot.samples[i], samples, buildLength, buildSampleRate, &job.cancelled))
+		{
+			// Left short, the audio thread queues the release
+			return;
+		}
+
+		// Heard as the snapshot was until the live buffer moves on
+		const SampleBuffer::Version &version = snapshot.getVersion(i);
+		built[i].setCompact(buildCompact);
+		built[i].epoch = version.epoch;
+		built[i].pass = version.pass;
+		built[i].assign(std::move(samples));
+	}
+	snapshot.release();
+}
+
+void BufferRebuilder::release()
+{
+	TRACE_SCOPE("BufferRebuilder::release");
+	for (SampleBuffer &buffer : built)
+		buffer = SampleBuffer();
+	snapshot.release();
+	std::vector<uint8_t>().swap(dirty);
+	std::vector<float>().swap(heard);
+}
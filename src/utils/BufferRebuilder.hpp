@@ -0,0 +1,133 @@
+#ifndef _BUFFER_REBUILDER
+#define _BUFFER_REBUILDER
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "BufferSnapshot.hpp"
+#include "SampleBuffer.hpp"
+#include "WorkerPool.hpp"
+
+/**
+ * Replaces the buffers with a time stretched or differently stored copy
+ * without O(n) work on the audio thread.
+ *
+ * A WorkerPool job allocates a BufferSnapshot for the audio thread to
+ * fill in process(), the next one builds the new SampleBuffers from it in
+ * the storage they are played from. The audio thread then copies the
+ * chunks the recorder wrote in the meantime, a few per call, and swaps
+ * the new storage in. A last job frees the old storage.
+ *
+ * A stretch leaves out what was recorded while it ran, the recording
+ * continues in the stretched buffer.
+ *
+ * Jobs never change the state, the audio thread moves it on once
+ * job.finished shows the job of the current one is done.
+ */
+struct BufferRebuilder
+{
+	enum State
+	{
+		IDLE,
+		ALLOCATING, // Job
+		COPYING,	// Audio thread fills the snapshot
+		BUILDING,	// Job
+		READY,		// Audio thread catches up and swaps
+		FREEING		// Job
+	};
+
+	// Chunks copied per process() call while catching up
+	static constexpr int CATCH_UP_CHUNKS = 2;
+
+	BufferRebuilder() {}
+	~BufferRebuilder();
+
+	BufferRebuilder(const BufferRebuilder &) = delete;
+	BufferRebuilder &operator=(const BufferRebuilder &) = delete;
+
+	// Audio thread, stretches the buffers to length keeping the pitch.
+	// Replaces a stretch to another length
+	void stretchTo(size_t length, float sampleRate);
+
+	// Audio thread, drops a pending or running stretch
+	void cancelStretch();
+
+	// Audio thread, storage the buffers are converted to, see
+	// SampleBuffer::setCompact
+	void setCompact(bool compact)
+	{
+		wantedCompact = compact;
+	}
+
+	// Rebuilds inside process() instead, for offline renders that have no
+	// deadline and need the same result on every run
+	void setSynchronous(bool synchronous)
+	{
+		this->synchronous = synchronous;
+	}
+
+	// Audio thread, call before the recorder writes at recordIndex. Returns
+	// true when a stretched buffer was swapped in
+	bool process(std::array<SampleBuffer, 2> &buffers, long recordIndex);
+
+	bool isStretching() const
+	{
+		return stretchLength > 0;
+	}
+
+private:
+	std::atomic<int> state{IDLE};
+	WorkerPool::Job job;
+
+	// Requested by the audio thread
+	size_t stretchLength = 0;
+	float stretchSampleRate = 44100.0f;
+	bool wantedCompact = false;
+	bool synchronous = false;
+
+	// Set before the first job of a rebuild
+	size_t sourceLength = 0;
+	size_t buildLength = 0;
+	float buildSampleRate = 44100.0f;
+	bool buildCompact = false;
+	bool buildStretch = false;
+	bool abandoned = false;
+
+	BufferSnapshot snapshot;
+	uint32_t revision[2] = {0, 0};
+	std::array<SampleBuffer, 2> built;
+
+	// Chunks the recorder wrote into since they were copied, only kept when
+	// the length stays the same. None before dirtyCursor
+	std::vector<uint8_t> dirty;
+	size_t dirtyCursor = 0;
+	std::vector<float> heard;
+
+	// Returns true when a stretched buffer was swapped in synchronously
+	bool start(std::array<SampleBuffer, 2> &buffers);
+
+	bool rebuildNow(std::array<SampleBuffer, 2> &buffers);
+
+	// Queues the job of the next state
+	void submit(State next);
+
+	void abandon();
+
+	void markDirty(long recordIndex);
+
+	// Copies up to CATCH_UP_CHUNKS dirty chunks, true once none are left
+	bool catchUp(const std::array<SampleBuffer, 2> &buffers);
+
+	bool finish(std::array<SampleBuffer, 2> &buffers, long recordIndex);
+
+	static void run(WorkerPool::Job &job);
+
+	void allocate();
+
+	void build();
+
+	void release();
+};
+
+#endif // _BUFFER_REBUILDER
@@ -0,0 +1,70 @@
+#include "BufferSnapshot.hpp"
+
+void BufferSnapshot::allocate(size_t length, int channels)
+{
+	this->length = length;
+	this->channels = channels;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		if (i < channels)
+			samples[i].assign(length, 0.0f);
+		else
+			std::vector<float>().swap(samples[i]);
+	}
+	copied.assign((length + SampleBuffer::CHUNK_SIZE - 1) >> SampleBuffer::CHUNK_SHIFT, 0);
+	nextChunk = 0;
+	copiedCount = 0;
+	begun = false;
+}
+
+void BufferSnapshot::release()
+{
+	for (std::vector<float> &channel : samples)
+		std::vector<float>().swap(channel);
+	std::vector<uint8_t>().swap(copied);
+	length = 0;
+	nextChunk = 0;
+	copiedCount = 0;
+	begun = false;
+}
+
+bool BufferSnapshot::process(const std::array<SampleBuffer, 2> &buffers, long recordIndex)
+{
+	if (!begun)
+	{
+		for (int i = 0; i < channels; ++i)
+		{
+			version[i] = buffers[i].version();
+			revision[i] = buffers[i].revision;
+		}
+		begun = true;
+	}
+
+	// Resized or replaced, the copy can't be finished
+	for (int i = 0; i < channels; ++i)
+		if (buffers[i].size() != length || buffers[i].revision != revision[i])
+			return false;
+
+	if (recordIndex >= 0 && (size_t)recordIndex < length)
+		copyChunk(buffers, (size_t)recordIndex >> SampleBuffer::CHUNK_SHIFT);
+
+	while (nextChunk < copied.size() && copied[nextChunk])
+		++nextChunk;
+	if (nextChunk < copied.size())
+		copyChunk(buffers, nextChunk);
+	return true;
+}
+
+void BufferSnapshot::copyChunk(const std::array<SampleBuffer, 2> &buffers, size_t chunk)
+{
+	if (copied[chunk])
+		return;
+
+	size_t begin = chunk << SampleBuffer::CHUNK_SHIFT;
+	for (int i = 0; i < channels; ++i)
+		buffers[i].readChunk(chunk, version[i], samples[i].data() + begin);
+
+	copied[chunk] = 1;
+	++copiedCount;
+}
@@ -0,0 +1,80 @@
+#ifndef _BUFFER_SNAPSHOT
+#define _BUFFER_SNAPSHOT
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "SampleBuffer.hpp"
+
+/**
+ * Copy of the buffers as they sounded when the copy began, taken on the
+ * audio thread a chunk or two per process() call.
+ *
+ * Chunks are read through the SampleBuffer::Version of the first call, so
+ * a clear or a new overdub pass leaves the chunks not copied yet as they
+ * were and nothing has to be copied ahead of them. Only the chunk the
+ * recorder is about to write into is copied early. A resized or replaced
+ * buffer ends the copy.
+ */
+struct BufferSnapshot
+{
+	std::array<std::vector<float>, 2> samples;
+
+	// Not on the audio thread, sizes the copy and starts it over
+	void allocate(size_t length, int channels);
+
+	// Not on the audio thread
+	void release();
+
+	// Audio thread, call before the recorder writes at recordIndex. Returns
+	// false once the buffers can't be copied anymore
+	bool process(const std::array<SampleBuffer, 2> &buffers, long recordIndex);
+
+	bool isComplete() const
+	{
+		return !copied.empty() && copiedCount == copied.size();
+	}
+
+	float getProgress() const
+	{
+		return copied.empty() ? 0.0f : (float)copiedCount / copied.size();
+	}
+
+	size_t getLength() const
+	{
+		return length;
+	}
+
+	int getChannels() const
+	{
+		return channels;
+	}
+
+	// What the copy was taken from, set by the first process() call
+	const SampleBuffer::Version &getVersion(int channel) const
+	{
+		return version[channel];
+	}
+
+	uint32_t getRevision(int channel) const
+	{
+		return revision[channel];
+	}
+
+private:
+	size_t length = 0;
+	int channels = 1;
+
+	std::vector<uint8_t> copied;
+	size_t nextChunk = 0;
+	size_t copiedCount = 0;
+
+	bool begun = false;
+	SampleBuffer::Version version[2];
+	uint32_t revision[2] = {0, 0};
+
+	void copyChunk(const std::array<SampleBuffer, 2> &buffers, size_t chunk);
+};
+
+#endif // _BUFFER_SNAPSHOT
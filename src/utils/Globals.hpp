@@ -8,6 +8,9 @@ constexpr t_clothtype CLOTHTYPE_PANTS = 2;
 constexpr t_clothtype CLOTHTYPE_SHOES = 3;
 constexpr int CLOTHTYPE_COUNT = 4;
 
+// Voltage of a full scale sample in wav files read or written
+constexpr float AUDIO_VOLTS = 5.0f;
+
 // Colors
 static const int COLOR_PRIMARY_INPUT[3] = { 56, 85, 116 };   // #385574
 static const int COLOR_PRIMARY_OUTPUT[3] = { 232, 108, 86 }; // #e86c56
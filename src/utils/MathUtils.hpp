@@ -2,6 +2,10 @@
 #define _MATH_UTILS
 
 #include <vector>
+#include <cmath>
+#include <cstdint>
+
+#include "SampleBuffer.hpp"
 
 #define MAX(a,b)((a>b?a:b))
 #define MIN(a,b)((a<b?a:b))
@@ -12,12 +16,21 @@ inline static float map(float x, float sa, float sb, float ea, float eb)
 	return (x - sa) / (sb - sa) * (eb - ea) + ea;
 }
 
+// Same as map but returns A for an empty range
+inline static float rangeMap(float x, float a, float b, float A, float B)
+{
+	if (b == a) return A;
+	return (x - a) / (b - a) * (B - A) + A;
+}
+
 template <typename T>
 inline static T modTrue(const T& a, const T& b)
 {
 	return ((a % b) + b) % b;
 }
 
+// The kernels accept any buffer with operator[] and size(),
+// like std::vector<float> or SampleBuffer
 struct SampleInterpolation
 {
 	struct Buffer
@@ -38,36 +51,81 @@ struct SampleInterpolation
 		}
 	};
 
-	static float none(const std::vector<float>& samples, float index) {
-		return samples[(size_t)index % samples.size()];
+	// Copies count neighbouring samples starting at first, wrapping around
+	template <typename T>
+	static void fetch(const T& samples, long first, int count, float* out) {
+		long size = static_cast<long>(samples.size());
+		for (int k = 0; k < count; ++k)
+			out[k] = samples[modTrue<long>(first + k, size)];
 	}
 
-	// Linear interpolation
-	static float linear(const std::vector<float>& samples, float index) {
-		size_t i0 = modTrue<int>((int)std::floor(index), (int)samples.size());
-		size_t i1 = (i0 + 1) % samples.size();
-
-		float t = index - floor(index);
-		return samples[i0] * (1.0f - t) + samples[i1] * t;
+	// Compact buffers decode the taps with SIMD conversions
+	static void fetch(const SampleBuffer& samples, long first, int count, float* out) {
+		samples.read(first, count, out);
 	}
 
-	static float optimal2X(const std::vector<float>& samples, float index)
+	/**
+	 * Read position as 32.32 fixed point, the integer sample index in the
+	 * high word and the fraction in the low word. A float index loses the
+	 * fraction past 2^24 samples, this stays exact for multi-minute loops.
+	 */
+	struct Position
 	{
-		float smpls;
-		smpls = static_cast<float>(samples.size());
-		index = fmod(index, smpls) + samples.size();
-		index = fmod(index, smpls);
+		uint64_t value = 0;
+
+		Position() {}
+
+		// phase is in buffer lengths and gets wrapped into [0, 1)
+		Position(double phase, size_t size)
+		{
+			phase -= std::floor(phase);
+			if (!(phase >= 0.0 && phase < 1.0)) // inf or nan
+				return;
+			value = (uint64_t)(phase * (double)size * 4294967296.0);
+			if ((size_t)index() >= size)
+				value = 0;
+		}
+
+		long index() const
+		{
+			return (long)(value >> 32);
+		}
+
+		float fraction() const
+		{
+			return (float)(value & 0xffffffffu) * (1.0f / 4294967296.0f);
+		}
+	};
 
-		int size = static_cast<int>(samples.size());
-		int i0 = static_cast<int>(index) % size;
-		int i1 = (i0 + 1) % size;
+	// The kernels below take the integer index i0, already wrapped into the
+	// buffer, and the fraction t between i0 and i0 + 1
 
-		float y0 = samples[i0];
-		float y1 = samples[i1];
+	template <typename T>
+	static float none(const T& samples, long i0, float t) {
+		float y;
+		fetch(samples, i0, 1, &y);
+		return y;
+	}
+
+	// Linear interpolation
+	template <typename T>
+	static float linear(const T& samples, long i0, float t) {
+		float y[2];
+		fetch(samples, i0, 2, y);
+		return y[0] * (1.0f - t) + y[1] * t;
+	}
+
+	template <typename T>
+	static float optimal2X(const T& samples, long i0, float t)
+	{
+		float y[2];
+		fetch(samples, i0, 2, y);
+		float y0 = y[0];
+		float y1 = y[1];
 
 		// Taken directly from https://yehar.com/blog/wp-content/uploads/2009/08/deip.pdf
 		// Optimal 2x (2-point, 3rd-order) (z-form)
-		float z = 1.0 - 1/2.0;
+		float z = t - 1/2.0;
 		float even1 = y1+y0, odd1 = y1-y0;
 		float c0 = even1*0.50037842517188658;
 		float c1 = odd1*1.00621089801788210;
@@ -76,27 +134,20 @@ struct SampleInterpolation
 		return ((c3*z+c2)*z+c1)*z+c0;
 	}
 
-	static float optimal8X(const std::vector<float>& samples, float index)
+	template <typename T>
+	static float optimal8X(const T& samples, long i0, float t)
 	{
-		double smpls;
-		smpls = static_cast<float>(samples.size());
-		index = fmod(index, smpls) + samples.size();
-		index = fmod(index, smpls);
-
-		int size = static_cast<int>(samples.size());
-		int i0 = static_cast<int>(index) % size;
-		int i1 = (i0 + 1) % size;
-		int i2 = (i0 + 2) % size;
-		int i3 = (i0 - 1 + size) % size;  // Wrap backward
-
-		float y0 = samples[i3];
-		float y1 = samples[i0];
-		float y2 = samples[i1];
-		float y3 = samples[i2];
-		
+		// y0 sits one sample behind i0
+		float y[4];
+		fetch(samples, i0 - 1, 4, y);
+		float y0 = y[0];
+		float y1 = y[1];
+		float y2 = y[2];
+		float y3 = y[3];
+
 		// Taken directly from https://yehar.com/blog/wp-content/uploads/2009/08/deip.pdf
 		// Optimal 8x (4-point, 2nd-order) (z-form)
-		float z = 1.0 - 1/2.0;
+		float z = t - 1/2.0;
 		float even1 = y2+y1, odd1 = y2-y1;
 		float even2 = y3+y0, odd2 = y3-y0;
 		float c0 = even1*0.32852206663814043 + even2*0.17147870380790242;
@@ -105,31 +156,21 @@ struct SampleInterpolation
 		return (c2*z+c1)*z+c0;
 	}
 
-	static float optimal32X(const std::vector<float>& samples, float index)
+	template <typename T>
+	static float optimal32X(const T& samples, long i0, float t)
 	{
-		double smpls;
-		smpls = static_cast<float>(samples.size());
-		index = fmod(index, smpls) + samples.size();
-		index = fmod(index, smpls);
-
-		int size = static_cast<int>(samples.size());
-		int i0 = static_cast<int>(index) % size;
-		int i1 = (i0 + 1) % size;
-		int i2 = (i0 + 2) % size;
-		int i3 = (i0 + 3) % size;
-		int im1 = (i0 - 1 + size) % size;
-		int im2 = (i0 - 1 + size) % size;
-
-		float ym2 = samples[im2];
-		float ym1 = samples[im1];
-		float y0 = samples[i0];
-		float y1 = samples[i1];
-		float y2 = samples[i2];
-		float y3 = samples[i3];
+		float y[6];
+		fetch(samples, i0 - 2, 6, y);
+		float ym2 = y[0];
+		float ym1 = y[1];
+		float y0 = y[2];
+		float y1 = y[3];
+		float y2 = y[4];
+		float y3 = y[5];
 
 		// Taken directly from https://yehar.com/blog/wp-content/uploads/2009/08/deip.pdf
 		// Optimal 32x (6-point, 5th-order) (z-form)
-		float z = 1.0 - 1/2.0;
+		float z = t - 1/2.0;
 		float even1 = y1+y0, odd1 = y1-y0;
 		float even2 = y2+ym1, odd2 = y2-ym1;
 		float even3 = y3+ym2, odd3 = y3-ym2;
@@ -148,21 +189,15 @@ struct SampleInterpolation
 		return ((((c5*z+c4)*z+c3)*z+c2)*z+c1)*z+c0;
 	}
 
-	static float cubic(const std::vector<float>& samples, float index) {
-		int size = static_cast<int>(samples.size());
-
-		int i0 = static_cast<int>(index);
-		int i1 = (i0 + 1) % size;
-		int i2 = (i0 + 2) % size;
-		int i3 = (i0 - 1 + size) % size;  // Wrap backward
-
-		float t = index - i0;  // Fractional part of the index
-
+	template <typename T>
+	static float cubic(const T& samples, long i0, float t) {
 		// Cubic Hermite spline
-		float a0 = samples[i3];
-		float a1 = samples[i0];
-		float a2 = samples[i1];
-		float a3 = samples[i2];
+		float a[4];
+		fetch(samples, i0 - 1, 4, a);
+		float a0 = a[0];
+		float a1 = a[1];
+		float a2 = a[2];
+		float a3 = a[3];
 
 		float t2 = t * t;
 		float t3 = t2 * t;
@@ -171,6 +206,32 @@ struct SampleInterpolation
 			0.5f * t2 * (2.0f * a0 - 5.0f * a1 + 4.0f * a2 - a3) +
 			0.5f * t3 * (-a0 + 3.0f * a1 - 3.0f * a2 + a3);
 	}
+
+	// Float index versions, the index wraps around the buffer
+
+	static void split(float index, size_t size, long& i0, float& t) {
+		float whole = std::floor(index);
+		i0 = modTrue<long>((long)whole, (long)size);
+		t = index - whole;
+	}
+
+#define SAMPLE_INTERPOLATION_FLOAT_INDEX(KERNEL) \
+	template <typename T> \
+	static float KERNEL(const T& samples, float index) { \
+		long i0; \
+		float t; \
+		split(index, samples.size(), i0, t); \
+		return KERNEL(samples, i0, t); \
+	}
+
+	SAMPLE_INTERPOLATION_FLOAT_INDEX(none)
+	SAMPLE_INTERPOLATION_FLOAT_INDEX(linear)
+	SAMPLE_INTERPOLATION_FLOAT_INDEX(optimal2X)
+	SAMPLE_INTERPOLATION_FLOAT_INDEX(optimal8X)
+	SAMPLE_INTERPOLATION_FLOAT_INDEX(optimal32X)
+	SAMPLE_INTERPOLATION_FLOAT_INDEX(cubic)
+
+#undef SAMPLE_INTERPOLATION_FLOAT_INDEX
 };
 
 class LowPassFilter {
@@ -0,0 +1,63 @@
+#include "QualityGovernor.hpp"
+
+const int QualityGovernor::BLOCK_SIZE;
+const int QualityGovernor::UP_BLOCKS;
+constexpr float QualityGovernor::UP_THRESHOLD;
+
+void QualityGovernor::reset()
+{
+	level = maxLevel;
+	load = 0.0f;
+	blockCycles = 0;
+	blockSamples = 0;
+	quietBlocks = 0;
+	ticksPerSecond = 0.0;
+	calibrationTicks = 0;
+}
+
+void QualityGovernor::endBlock(float sampleTime)
+{
+	uint64_t cycles = blockCycles;
+	blockCycles = 0;
+	blockSamples = 0;
+
+	// The counter rate isn't known up front, compare it with wall time
+	// over every block and keep a smoothed estimate
+	uint64_t nowTicks = readCycleCounter();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (calibrationTicks != 0)
+	{
+		double seconds = std::chrono::duration<double>(now - calibrationTime).count();
+		if (seconds > 0.0)
+		{
+			double rate = (nowTicks - calibrationTicks) / seconds;
+			ticksPerSecond = ticksPerSecond == 0.0 ? rate : ticksPerSecond * 0.9 + rate * 0.1;
+		}
+	}
+	calibrationTicks = nowTicks;
+	calibrationTime = now;
+
+	if (ticksPerSecond <= 0.0 || sampleTime <= 0.0f)
+		return;
+
+	load = (float)(cycles / ticksPerSecond / (BLOCK_SIZE * (double)sampleTime));
+
+	if (load > budget)
+	{
+		if (level > 0)
+			--level;
+		quietBlocks = 0;
+	}
+	else if (load < budget * UP_THRESHOLD)
+	{
+		if (++quietBlocks >= UP_BLOCKS && level < maxLevel)
+		{
+			++level;
+			quietBlocks = 0;
+		}
+	}
+	else
+	{
+		quietBlocks = 0;
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef _QUALITY_GOVERNOR
+#define _QUALITY_GOVERNOR
+
+#include <cstdint>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheapest monotonic counter the cpu has, the unit is calibrated at runtime
+inline static uint64_t readCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t value;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+	return value;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+#endif
+}
+
+/**
+ * Measures how much of the sample period a module spends in process()
+ * and picks a quality level to stay under a budget.
+ *
+ * Plays at maxLevel until there is an overload. Costs are summed over
+ * blocks of BLOCK_SIZE samples, a block over the budget drops one level.
+ * A dropped level only goes back up after UP_BLOCKS blocks in a row under
+ * UP_THRESHOLD of the budget.
+ */
+struct QualityGovernor
+{
+	static const int BLOCK_SIZE = 1024;
+	static const int UP_BLOCKS = 32;
+	static constexpr float UP_THRESHOLD = 0.5f;
+
+	// Fraction of the sample period process() may use
+	float budget = 0.05f;
+
+	int maxLevel = 0;
+	int level = 0;
+
+	// Last block's cost as a fraction of the sample period, for display
+	float load = 0.0f;
+
+	QualityGovernor(int maxLevel = 0) : maxLevel(maxLevel), level(maxLevel)
+	{
+	}
+
+	// A newly selected level plays at once, overloads step down from it
+	void setMaxLevel(int maxLevel)
+	{
+		if (maxLevel != this->maxLevel)
+			level = maxLevel;
+		this->maxLevel = maxLevel;
+	}
+
+	void begin()
+	{
+		processStart = readCycleCounter();
+	}
+
+	void end(float sampleTime)
+	{
+		blockCycles += readCycleCounter() - processStart;
+		if (++blockSamples >= BLOCK_SIZE)
+			endBlock(sampleTime);
+	}
+
+	void reset();
+
+private:
+	uint64_t processStart = 0;
+	uint64_t blockCycles = 0;
+	int blockSamples = 0;
+	int quietBlocks = 0;
+
+	// Counter ticks per second, calibrated against steady_clock
+	double ticksPerSecond = 0.0;
+	uint64_t calibrationTicks = 0;
+	std::chrono::steady_clock::time_point calibrationTime;
+
+	void endBlock(float sampleTime);
+};
+
+#endif // _QUALITY_GOVERNOR
@@ -0,0 +1,326 @@
+#include "SampleBuffer.hpp"
+#include "SimdUtils.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+constexpr int SampleBuffer::CHUNK_SHIFT;
+constexpr size_t SampleBuffer::CHUNK_SIZE;
+constexpr uint32_t SampleBuffer::DECAY_TABLE_SIZE;
+constexpr int SampleBuffer::DEFAULT_EXPONENT;
+constexpr int SampleBuffer::MAX_EXPONENT;
+
+static float exponentScale(int exponent)
+{
+	return std::ldexp(1.0f, exponent - 15);
+}
+
+// Quantizes len samples with the finest exponent that fits them all
+static int encodeChunk(const float *in, size_t len, int16_t *out)
+{
+	float peak = 0.0f;
+	for (size_t i = 0; i < len; ++i)
+		peak = std::max(peak, std::fabs(in[i]));
+
+	int exponent = SampleBuffer::DEFAULT_EXPONENT;
+	if (peak > 0.0f)
+	{
+		int peakExponent;
+		std::frexp(peak, &peakExponent);
+		exponent = std::max(exponent, std::min(peakExponent, SampleBuffer::MAX_EXPONENT));
+	}
+
+	float invScale = 1.0f / exponentScale(exponent);
+	for (size_t i = 0; i < len; ++i)
+	{
+		float q = std::min(std::max(in[i] * invScale, -32767.0f), 32767.0f);
+		out[i] = (int16_t)std::lrint(q);
+	}
+	return exponent;
+}
+
+SampleBuffer::SampleBuffer()
+{
+	std::fill(decayTable, decayTable + DECAY_TABLE_SIZE, 1.0f);
+}
+
+float SampleBuffer::at(size_t i) const
+{
+	if (i >= size())
+		throw std::out_of_range("SampleBuffer::at");
+	return (*this)[i];
+}
+
+void SampleBuffer::read(long first, size_t count, float *out) const
+{
+	size_t n = size();
+	if (n == 0)
+	{
+		std::fill(out, out + count, 0.0f);
+		return;
+	}
+
+	size_t i = (size_t)(((first % (long)n) + (long)n) % (long)n);
+	while (count > 0)
+	{
+		size_t chunk = i >> CHUNK_SHIFT;
+		size_t end = std::min((chunk + 1) << CHUNK_SHIFT, n);
+		size_t len = std::min(end - i, count);
+
+		if (!isChunkValid(chunk))
+			std::fill(out, out + len, 0.0f);
+		else if (compact)
+			decodeInt16(&packed[i], len, chunkScale[chunk] * chunkGain(chunk), out);
+		else
+			scaleFloat(&data[i], len, chunkGain(chunk), out);
+
+		out += len;
+		count -= len;
+		i = (end == n) ? 0 : end;
+	}
+}
+
+void SampleBuffer::readChunk(size_t chunk, const Version &version, float *out) const
+{
+	size_t begin = chunk << CHUNK_SHIFT;
+	size_t len = std::min(CHUNK_SIZE, size() - begin);
+	if (chunkEpoch[chunk] != version.epoch)
+	{
+		std::fill(out, out + len, 0.0f);
+		return;
+	}
+
+	uint32_t age = version.pass - chunkPass[chunk];
+	float gain = version.feedback == feedback && age < DECAY_TABLE_SIZE
+					 ? decayTable[age]
+					 : std::pow(version.feedback, (float)age);
+	if (compact)
+		decodeInt16(&packed[begin], len, chunkScale[chunk] * gain, out);
+	else
+		scaleFloat(&data[begin], len, gain, out);
+}
+
+void SampleBuffer::setFeedback(float feedback)
+{
+	this->feedback = feedback;
+	float gain = 1.0f;
+	for (uint32_t i = 0; i < DECAY_TABLE_SIZE; ++i)
+	{
+		decayTable[i] = gain;
+		gain *= feedback;
+	}
+}
+
+float SampleBuffer::decayGain(uint32_t age) const
+{
+	// Only reached by chunks the recorder skipped for a long time
+	return std::pow(feedback, (float)age);
+}
+
+void SampleBuffer::setCompact(bool compact)
+{
+	if (this->compact == compact)
+		return;
+
+	std::vector<float> samples = toVector();
+	this->compact = compact;
+	++revision;
+	// Release the old storage
+	std::vector<float>().swap(data);
+	std::vector<int16_t>().swap(packed);
+	assign(std::move(samples));
+}
+
+void SampleBuffer::resize(size_t size)
+{
+	if (size != this->size())
+		++revision;
+	// New chunks start valid, their samples are value initialized
+	if (compact)
+		packed.resize(size);
+	else
+		data.resize(size);
+	resizeChunks((size + CHUNK_SIZE - 1) >> CHUNK_SHIFT);
+}
+
+void SampleBuffer::assign(std::vector<float> &&samples)
+{
+	size_t chunks = (samples.size() + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+	++revision;
+	chunkEpoch.assign(chunks, epoch);
+	chunkPass.assign(chunks, pass);
+
+	if (!compact)
+	{
+		data = std::move(samples);
+		return;
+	}
+
+	packed.resize(samples.size());
+	chunkExponent.resize(chunks);
+	chunkScale.resize(chunks);
+	for (size_t chunk = 0; chunk < chunks; ++chunk)
+	{
+		size_t begin = chunk << CHUNK_SHIFT;
+		size_t len = std::min(CHUNK_SIZE, samples.size() - begin);
+		setChunkExponent(chunk, encodeChunk(&samples[begin], len, &packed[begin]));
+	}
+}
+
+void SampleBuffer::assignChunk(size_t chunk, const float *samples)
+{
+	size_t begin = chunk << CHUNK_SHIFT;
+	size_t len = std::min(CHUNK_SIZE, size() - begin);
+	if (compact)
+		setChunkExponent(chunk, encodeChunk(samples, len, &packed[begin]));
+	else
+		std::copy(samples, samples + len, data.begin() + begin);
+	chunkEpoch[chunk] = epoch;
+	chunkPass[chunk] = pass;
+}
+
+void SampleBuffer::swap(SampleBuffer &other)
+{
+	std::swap(compact, other.compact);
+	data.swap(other.data);
+	packed.swap(other.packed);
+	chunkExponent.swap(other.chunkExponent);
+	chunkScale.swap(other.chunkScale);
+	chunkEpoch.swap(other.chunkEpoch);
+	chunkPass.swap(other.chunkPass);
+	++revision;
+	++other.revision;
+}
+
+std::vector<float> SampleBuffer::toVector() const
+{
+	std::vector<float> out(size(), 0.0f);
+	if (!out.empty())
+		read(0, out.size(), out.data());
+	return out;
+}
+
+void SampleBuffer::toPacked(std::vector<int16_t> &pcm, std::vector<int8_t> &exponents) const
+{
+	size_t n = size();
+	pcm.resize(n);
+	exponents.resize(chunkCount());
+
+	std::vector<float> heard(CHUNK_SIZE);
+	for (size_t chunk = 0; chunk < chunkCount(); ++chunk)
+	{
+		size_t begin = chunk << CHUNK_SHIFT;
+		size_t len = std::min(CHUNK_SIZE, n - begin);
+		read(begin, len, heard.data());
+		exponents[chunk] = (int8_t)encodeChunk(heard.data(), len, &pcm[begin]);
+	}
+}
+
+void SampleBuffer::assignPacked(std::vector<int16_t> &&pcm, const std::vector<int8_t> &exponents)
+{
+	size_t chunks = (pcm.size() + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+	if (exponents.size() != chunks)
+		return;
+	++revision;
+
+	chunkEpoch.assign(chunks, epoch);
+	chunkPass.assign(chunks, pass);
+
+	if (compact)
+	{
+		packed = std::move(pcm);
+		chunkExponent.resize(chunks);
+		chunkScale.resize(chunks);
+		for (size_t chunk = 0; chunk < chunks; ++chunk)
+			setChunkExponent(chunk, std::min((int)exponents[chunk], MAX_EXPONENT));
+		return;
+	}
+
+	data.resize(pcm.size());
+	for (size_t chunk = 0; chunk < chunks; ++chunk)
+	{
+		size_t begin = chunk << CHUNK_SHIFT;
+		size_t len = std::min(CHUNK_SIZE, pcm.size() - begin);
+		decodeInt16(&pcm[begin], len, exponentScale(exponents[chunk]), &data[begin]);
+	}
+}
+
+void SampleBuffer::claimChunk(size_t chunk)
+{
+	size_t begin = chunk << CHUNK_SHIFT;
+	if (compact)
+	{
+		size_t end = std::min(begin + CHUNK_SIZE, packed.size());
+		std::fill(packed.begin() + begin, packed.begin() + end, 0);
+		setChunkExponent(chunk, DEFAULT_EXPONENT);
+	}
+	else
+	{
+		size_t end = std::min(begin + CHUNK_SIZE, data.size());
+		std::fill(data.begin() + begin, data.begin() + end, 0.0f);
+	}
+	chunkEpoch[chunk] = epoch;
+	chunkPass[chunk] = pass;
+}
+
+void SampleBuffer::rescaleChunk(size_t chunk)
+{
+	size_t begin = chunk << CHUNK_SHIFT;
+	float gain = chunkGain(chunk);
+	if (compact)
+	{
+		// gain <= 1 so the samples still fit the chunk's scale
+		size_t end = std::min(begin + CHUNK_SIZE, packed.size());
+		for (size_t i = begin; i < end; ++i)
+			packed[i] = (int16_t)std::lrint(packed[i] * gain);
+	}
+	else
+	{
+		size_t end = std::min(begin + CHUNK_SIZE, data.size());
+		for (size_t i = begin; i < end; ++i)
+			data[i] *= gain;
+	}
+	chunkPass[chunk] = pass;
+}
+
+void SampleBuffer::resizeChunks(size_t chunks)
+{
+	chunkEpoch.resize(chunks, epoch);
+	chunkPass.resize(chunks, pass);
+	if (compact)
+	{
+		chunkExponent.resize(chunks, DEFAULT_EXPONENT);
+		chunkScale.resize(chunks, exponentScale(DEFAULT_EXPONENT));
+	}
+}
+
+void SampleBuffer::setChunkExponent(size_t chunk, int exponent)
+{
+	chunkExponent[chunk] = (int8_t)exponent;
+	chunkScale[chunk] = exponentScale(exponent);
+}
+
+float SampleBuffer::growChunk(size_t chunk, float value)
+{
+	int exponent = chunkExponent[chunk];
+	int valueExponent;
+	std::frexp(value, &valueExponent);
+	valueExponent = std::min(valueExponent, MAX_EXPONENT);
+
+	if (valueExponent > exponent)
+	{
+		// Requantizing to a coarser power of two scale is a shift
+		int shift = valueExponent - exponent;
+		size_t begin = chunk << CHUNK_SHIFT;
+		size_t end = std::min(begin + CHUNK_SIZE, packed.size());
+		for (size_t i = begin; i < end; ++i)
+			packed[i] = (int16_t)(shift >= 16 ? 0 : packed[i] >> shift);
+		setChunkExponent(chunk, valueExponent);
+	}
+
+	float q = value / chunkScale[chunk];
+	// Clips values beyond MAX_EXPONENT, NaN becomes silence
+	if (!(q == q))
+		return 0.0f;
+	return std::min(std::max(q, -32767.0f), 32767.0f);
+}
@@ -0,0 +1,246 @@
+#ifndef _SAMPLE_BUFFER
+#define _SAMPLE_BUFFER
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+/**
+ * Audio buffer that is split into fixed size chunks.
+ *
+ * Every chunk remembers the epoch in which it was last written.
+ * Clearing the buffer only bumps the current epoch, chunks from an
+ * older epoch are read as silence until the recorder writes into them
+ * again, so a clear costs the same no matter how long the buffer is.
+ *
+ * For overdubbing every chunk also remembers the recording pass in
+ * which its samples were last rescaled. Older layers are heard through
+ * feedback^(pass - chunkPass), the decay is baked into the samples the
+ * first time the recorder touches the chunk in a new pass.
+ *
+ * In compact mode samples are stored as int16 with a power of two scale
+ * per chunk, half the memory of float. A chunk starts at +-1V full scale
+ * and is shifted down to a coarser scale when a louder sample arrives.
+ */
+struct SampleBuffer
+{
+	static constexpr int CHUNK_SHIFT = 12;
+	static constexpr size_t CHUNK_SIZE = (size_t)1 << CHUNK_SHIFT;
+	static constexpr uint32_t DECAY_TABLE_SIZE = 256;
+
+	// Full scale of a compact chunk is 2^exponent volts
+	static constexpr int DEFAULT_EXPONENT = 0;
+	static constexpr int MAX_EXPONENT = 7;
+
+	bool compact = false;
+	std::vector<float> data;
+	std::vector<int16_t> packed;
+	std::vector<int8_t> chunkExponent;
+	std::vector<float> chunkScale; // Volts per int16 step
+
+	std::vector<uint32_t> chunkEpoch;
+	std::vector<uint32_t> chunkPass;
+	uint32_t epoch = 0;
+	uint32_t pass = 0;
+	// Bumped when the samples are replaced or the size changes
+	uint32_t revision = 0;
+
+	float feedback = 1.0f;
+	// decayTable[n] = feedback^n
+	float decayTable[DECAY_TABLE_SIZE];
+
+	// What decides how the stored samples are heard, see readChunk()
+	struct Version
+	{
+		uint32_t epoch;
+		uint32_t pass;
+		float feedback;
+	};
+
+	SampleBuffer();
+
+	Version version() const
+	{
+		Version version;
+		version.epoch = epoch;
+		version.pass = pass;
+		version.feedback = feedback;
+		return version;
+	}
+
+	size_t size() const
+	{
+		return compact ? packed.size() : data.size();
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	// Heap held by the samples and the chunk tables
+	size_t bytes() const
+	{
+		return data.capacity() * sizeof(float) +
+			   packed.capacity() * sizeof(int16_t) +
+			   chunkExponent.capacity() * sizeof(int8_t) +
+			   chunkScale.capacity() * sizeof(float) +
+			   (chunkEpoch.capacity() + chunkPass.capacity()) * sizeof(uint32_t);
+	}
+
+	size_t chunkCount() const
+	{
+		return chunkEpoch.size();
+	}
+
+	bool isChunkValid(size_t chunk) const
+	{
+		return chunkEpoch[chunk] == epoch;
+	}
+
+	float chunkGain(size_t chunk) const
+	{
+		uint32_t age = pass - chunkPass[chunk];
+		return age < DECAY_TABLE_SIZE ? decayTable[age] : decayGain(age);
+	}
+
+	float operator[](size_t i) const
+	{
+		size_t chunk = i >> CHUNK_SHIFT;
+		if (!isChunkValid(chunk))
+			return 0.0f;
+		return stored(i, chunk) * chunkGain(chunk);
+	}
+
+	float at(size_t i) const;
+
+	// y0[k] and y1[k] are the samples at index[k] and the one after it,
+	// wrapping around, for every k under count. The indices must be in the
+	// buffer. A pair within one chunk looks the chunk up once
+	void gatherPairs(const long *index, int count, float *y0, float *y1) const
+	{
+		size_t n = size();
+		for (int k = 0; k < count; ++k)
+		{
+			size_t i = (size_t)index[k];
+			size_t j = i + 1 == n ? 0 : i + 1;
+			size_t chunk = i >> CHUNK_SHIFT;
+			if ((j >> CHUNK_SHIFT) != chunk)
+			{
+				y0[k] = (*this)[i];
+				y1[k] = (*this)[j];
+			}
+			else if (!isChunkValid(chunk))
+				y0[k] = y1[k] = 0.0f;
+			else
+			{
+				float gain = chunkGain(chunk);
+				y0[k] = stored(i, chunk) * gain;
+				y1[k] = stored(j, chunk) * gain;
+			}
+		}
+	}
+
+	// Copies count samples starting at first into out, wrapping around the end
+	void read(long first, size_t count, float *out) const;
+
+	// Copies the chunk as it was heard at an earlier version, as long as the
+	// recorder hasn't written into it since
+	void readChunk(size_t chunk, const Version &version, float *out) const;
+
+	void write(size_t i, float value)
+	{
+		size_t chunk = i >> CHUNK_SHIFT;
+		touchChunk(chunk);
+		if (compact)
+			store(i, chunk, value);
+		else
+			data[i] = value;
+	}
+
+	// Adds on top of the decayed older layers
+	void overdub(size_t i, float value)
+	{
+		size_t chunk = i >> CHUNK_SHIFT;
+		touchChunk(chunk);
+		if (compact)
+			store(i, chunk, stored(i, chunk) + value);
+		else
+			data[i] += value;
+	}
+
+	// O(1), stale chunks are zeroed lazily by write()
+	void clear()
+	{
+		++epoch;
+	}
+
+	// O(1), every layer becomes one pass older
+	void nextPass()
+	{
+		++pass;
+	}
+
+	void setFeedback(float feedback);
+
+	// Converts the storage, what is heard stays the same up to quantization
+	void setCompact(bool compact);
+
+	void resize(size_t size);
+
+	void assign(std::vector<float> &&samples);
+
+	// Replaces one chunk with samples heard now, in the current epoch and pass
+	void assignChunk(size_t chunk, const float *samples);
+
+	// O(1), exchanges the stored samples and their chunks. Both buffers keep
+	// their epoch, pass and feedback, so a chunk from before the other's last
+	// clear is stale
+	void swap(SampleBuffer &other);
+
+	// Copy of the buffer as it is heard, stale chunks are zeroes
+	std::vector<float> toVector() const;
+
+	// int16 copy of the buffer as it is heard with one exponent per chunk
+	void toPacked(std::vector<int16_t> &pcm, std::vector<int8_t> &exponents) const;
+
+	void assignPacked(std::vector<int16_t> &&pcm, const std::vector<int8_t> &exponents);
+
+private:
+	float stored(size_t i, size_t chunk) const
+	{
+		return compact ? packed[i] * chunkScale[chunk] : data[i];
+	}
+
+	void store(size_t i, size_t chunk, float value)
+	{
+		float q = value / chunkScale[chunk];
+		if (!(std::fabs(q) < 32767.0f))
+			q = growChunk(chunk, value);
+		packed[i] = (int16_t)std::lrint(q);
+	}
+
+	void touchChunk(size_t chunk)
+	{
+		if (!isChunkValid(chunk))
+			claimChunk(chunk);
+		else if (chunkPass[chunk] != pass)
+			rescaleChunk(chunk);
+	}
+
+	float decayGain(uint32_t age) const;
+
+	void claimChunk(size_t chunk);
+
+	void rescaleChunk(size_t chunk);
+
+	void resizeChunks(size_t chunks);
+
+	void setChunkExponent(size_t chunk, int exponent);
+
+	// Moves the chunk to a scale that fits value, returns value quantized to it
+	float growChunk(size_t chunk, float value);
+};
+
+#endif // _SAMPLE_BUFFER
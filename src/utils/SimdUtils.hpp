@@ -0,0 +1,142 @@
+#ifndef _SIMD_UTILS
+#define _SIMD_UTILS
+
+#include <cstddef>
+#include <cstdint>
+
+// Define SIMD_UTILS_SCALAR to build only the plain loops, for benchmarks
+#if defined(__SSE2__) && !defined(SIMD_UTILS_SCALAR)
+#define SIMD_UTILS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && !defined(SIMD_UTILS_SCALAR)
+#define SIMD_UTILS_NEON
+#include <arm_neon.h>
+#endif
+
+// out[i] = in[i] * scale
+inline static void decodeInt16(const int16_t *in, size_t count, float scale, float *out)
+{
+	size_t i = 0;
+#if defined(SIMD_UTILS_SSE2)
+	const __m128 s = _mm_set1_ps(scale);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+		// Sign extend by unpacking into the high half and shifting back
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+	}
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i x = _mm_loadl_epi64((const __m128i *)(in + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+	}
+#elif defined(SIMD_UTILS_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for (; i + 8 <= count; i += 8)
+	{
+		int16x8_t x = vld1q_s16(in + i);
+		int32x4_t lo = vmovl_s16(vget_low_s16(x));
+		int32x4_t hi = vmovl_s16(vget_high_s16(x));
+		vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(lo), s));
+		vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(hi), s));
+	}
+	for (; i + 4 <= count; i += 4)
+	{
+		int32x4_t lo = vmovl_s16(vld1_s16(in + i));
+		vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(lo), s));
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = in[i] * scale;
+}
+
+// out[i] = in[i] * scale
+inline static void scaleFloat(const float *in, size_t count, float scale, float *out)
+{
+	size_t i = 0;
+#if defined(SIMD_UTILS_SSE2)
+	const __m128 s = _mm_set1_ps(scale);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), s));
+#elif defined(SIMD_UTILS_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), s));
+#endif
+	for (; i < count; ++i)
+		out[i] = in[i] * scale;
+}
+
+// ab = sum(a[i] * b[i]), bb = sum(b[i] * b[i])
+inline static void correlate(const float *a, const float *b, size_t count, float &ab, float &bb)
+{
+	size_t i = 0;
+	ab = 0.0f;
+	bb = 0.0f;
+#if defined(SIMD_UTILS_SSE2)
+	__m128 sumAB = _mm_setzero_ps();
+	__m128 sumBB = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(a + i);
+		__m128 y = _mm_loadu_ps(b + i);
+		sumAB = _mm_add_ps(sumAB, _mm_mul_ps(x, y));
+		sumBB = _mm_add_ps(sumBB, _mm_mul_ps(y, y));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, sumAB);
+	ab = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	_mm_storeu_ps(lanes, sumBB);
+	bb = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SIMD_UTILS_NEON)
+	float32x4_t sumAB = vdupq_n_f32(0.0f);
+	float32x4_t sumBB = vdupq_n_f32(0.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4_t x = vld1q_f32(a + i);
+		float32x4_t y = vld1q_f32(b + i);
+		sumAB = vmlaq_f32(sumAB, x, y);
+		sumBB = vmlaq_f32(sumBB, y, y);
+	}
+	float lanes[4];
+	vst1q_f32(lanes, sumAB);
+	ab = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	vst1q_f32(lanes, sumBB);
+	bb = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for (; i < count; ++i)
+	{
+		ab += a[i] * b[i];
+		bb += b[i] * b[i];
+	}
+}
+
+// sum(gain[i] * (y0[i] + t[i] * (y1[i] - y0[i]))) over 4 lanes,
+// unused lanes need a zero gain
+inline static float lerpSum4(const float *y0, const float *y1, const float *t, const float *gain)
+{
+#if defined(SIMD_UTILS_SSE2)
+	__m128 a = _mm_loadu_ps(y0);
+	__m128 lerp = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(t), _mm_sub_ps(_mm_loadu_ps(y1), a)));
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_mul_ps(lerp, _mm_loadu_ps(gain)));
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SIMD_UTILS_NEON)
+	float32x4_t a = vld1q_f32(y0);
+	float32x4_t lerp = vmlaq_f32(a, vld1q_f32(t), vsubq_f32(vld1q_f32(y1), a));
+	float lanes[4];
+	vst1q_f32(lanes, vmulq_f32(lerp, vld1q_f32(gain)));
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+	float sum = 0.0f;
+	for (int i = 0; i < 4; ++i)
+		sum += gain[i] * (y0[i] + t[i] * (y1[i] - y0[i]));
+	return sum;
+#endif
+}
+
+#endif // _SIMD_UTILS
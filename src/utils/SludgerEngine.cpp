@@ -0,0 +1,474 @@
+#include "SludgerEngine.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+
+void SludgerEngine::resizeBuffer(int sampleRate, bool disableSpeed)
+{
+	// Allow up to 16 changes a second to the sampleRate
+	if (lastResizeFrame < sampleRate / 16 && !firstBeat)
+	{
+		return;
+	}
+
+	TRACE_SCOPE("SludgerEngine::resizeBuffer");
+
+	long sampleCount = static_cast<long>(sampleRate * masterLength);
+	if (sampleCount < 1)
+	{
+		sampleCount = 1;
+	}
+	
+	float speedRatio = 0;
+	if (!samples[0].empty())
+	{
+		speedRatio = static_cast<float>(sampleCount);
+		speedRatio /= samples[0].size();
+	}
+
+	if (this->enableSpeedChange && speedRatio != 0 && !disableSpeed)
+	{
+		// The stretched buffer is counted when it's swapped in. A stretch
+		// to the same length carries on, another length replaces it
+		if (this->preservePitch)
+			rebuilder.stretchTo(sampleCount, sampleRate);
+		else
+		{
+			rebuilder.cancelStretch();
+			resizeBufferSpeed(sampleCount);
+			++resizeCount;
+		}
+	}
+	else
+	{
+		rebuilder.cancelStretch();
+		for (int i = 0; i < 2; ++i)
+			samples[i].resize(static_cast<size_t>(sampleCount));
+		++resizeCount;
+	}
+
+	// DEBUG("%d %d", (int)samples[0].size(), (int)samples[1].size());
+
+	lastResizeFrame = 0;
+}
+
+void SludgerEngine::resizeBufferSpeed(long targetSampleCount)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		if (samples[i].empty())
+			continue;
+
+		double currentSize = samples[i].size();
+		double speedRatio = static_cast<double>(targetSampleCount);
+		speedRatio /= currentSize;
+
+		// Skip if speed change is too small to be noticeable (<0.5%)
+		if (std::abs(speedRatio - 1.0) < 0.005)
+		{
+			continue;
+		}
+
+		// Resample with linear interpolation (or better algorithm)
+		std::vector<float> resampled(targetSampleCount);
+		for (long n = 0; n < targetSampleCount; ++n)
+		{
+			double oldPos = n / speedRatio;
+			size_t left = static_cast<size_t>(oldPos);
+			size_t right = std::min(left + 1, samples[i].size() - 1);
+			double frac = oldPos - left;
+			resampled[n] =
+				samples[i][left] * (1.0 - frac) +
+				samples[i][right] * frac;
+		}
+
+		samples[i].assign(std::move(resampled));
+	}
+}
+
+bool SludgerEngine::trackTempo(float interval)
+{
+	// The internal BPM or a loaded wav may have changed the length since
+	tempoTracker.committedPeriod = this->masterLength;
+	if (!tempoTracker.process(interval))
+		return false;
+	this->masterLength = tempoTracker.committedPeriod;
+	return true;
+}
+
+void SludgerEngine::reset(bool resetFirstBeat)
+{
+	timeSinceStep = 0.0f;
+	if (resetFirstBeat)
+	{
+		firstBeat = true;
+		tempoTracker.reset();
+	}
+	lastPhaseIn = 0.f;
+	recordingIndex = 0;
+	automationPhase = 0;
+	diffAdd = 0.0;
+}
+
+// Interpolation modes the governor steps through, cheapest first
+static const int QUALITY_LADDER[] = {
+	SludgerEngine::INTERPOLATION_MODE_LINEAR,
+	SludgerEngine::INTERPOLATION_MODE_CUBIC,
+	SludgerEngine::INTERPOLATION_MODE_OPTIMAL_8X,
+	SludgerEngine::INTERPOLATION_MODE_OPTIMAL_32X};
+static const int QUALITY_LADDER_LEN = sizeof(QUALITY_LADDER) / sizeof(QUALITY_LADDER[0]);
+
+int SludgerEngine::getInterpolationMode()
+{
+	if (!adaptiveQuality)
+		return interpolationMode;
+
+	// None and optimal 2x are already cheap
+	int userLevel = -1;
+	for (int i = 0; i < QUALITY_LADDER_LEN; ++i)
+	{
+		if (QUALITY_LADDER[i] == interpolationMode)
+			userLevel = i;
+	}
+	if (userLevel < 0)
+		return interpolationMode;
+
+	governor.setMaxLevel(userLevel);
+	return QUALITY_LADDER[governor.level];
+}
+
+float SludgerEngine::readTaps(const SampleBuffer &buffer, const long *tapIndex, const float *tapFraction)
+{
+	// Gather both neighbours of every head in one pass, then lerp and sum
+	// them at once. Unused heads have no gain
+	float y0[MAX_TAPS] = {};
+	float y1[MAX_TAPS] = {};
+	float gain[MAX_TAPS] = {};
+	buffer.gatherPairs(tapIndex, tapCount, y0, y1);
+	for (int t = 0; t < tapCount; ++t)
+		gain[t] = tapGain[t];
+	return lerpSum4(y0, y1, tapFraction, gain);
+}
+
+void SludgerEngine::process(const Input &in)
+{
+	if (adaptiveQuality)
+		governor.begin();
+
+	if (lsampleRate != in.sampleRate)
+	{
+		for (int i = 0; i < 2; ++i)
+			outFilter[i].setCoefficients(20000.9, in.sampleRate);
+	}
+	lsampleRate = in.sampleRate;
+
+	if (in.audioConnected[0])
+	{
+		isStereo = in.audioConnected[1];
+	}
+
+	if (clearBufferTrigger.process(in.clear))
+	{
+		for (SampleBuffer &buffer : samples)
+			buffer.clear();
+	}
+
+	if (resetTrigger.process(in.reset))
+	{
+		reset(true);
+	}
+
+	if (!in.externalBpm && in.bpm != 0)
+	{
+		this->masterLength = 60 / in.bpm;
+		if (this->masterLength != this->lmasterLength)
+		{
+			resizeBuffer(in.sampleRate);
+		}
+		if (this->masterLength != 0)
+			this->phaseOut += in.sampleTime / this->masterLength;
+	}
+	else if (
+		in.stepConnected &&
+		this->masterLength != 0)
+	{
+		if (clockTrigger.process(in.step))
+		{
+			bool tempoChanged = !firstBeat && trackTempo(timeSinceStep);
+			reset();
+			if (tempoChanged || firstBeat)
+				resizeBuffer(in.sampleRate);
+		}
+		firstBeat = false;
+		if (this->masterLength != 0)
+			this->phaseOut += in.sampleTime / this->masterLength;
+	}
+	else if (in.phaseConnected)
+	{
+		float dif = std::fabs(lastPhaseIn - in.phase);
+		if (dif > 0.5)
+		{
+			bool tempoChanged = !firstBeat && trackTempo(timeSinceStep);
+			reset();
+			if (tempoChanged || firstBeat)
+				resizeBuffer(in.sampleRate);
+		}
+		firstBeat = false;
+	}
+	else
+	{
+		reset(true);
+	}
+
+	// Before the buffers are read, a stretch changes their length.
+	// Converting the storage is O(n), the rebuilder does it off this thread
+	rebuilder.setCompact(compactStorage);
+	if (rebuilder.process(samples, recordingIndex < (long)samples[0].size() ? recordingIndex : 0))
+		++resizeCount;
+
+	bool skipProcessing = false;
+
+	float automationInput = in.automation;
+	automationInput = std::fmod(std::fmod(automationInput, 10.0f) + 10.0f, 10.0f);
+
+	if (automationMode == AUTOMATION_MODE_DERIVATIVE)
+	{
+		automationPhase = recordingIndex;
+		automationPhase /= ((double)(samples[0].size()) + GNOME_PLEASING_NUMBER);
+		automationPhase += 2 * (automationInput / 10. - 0.5);
+		// automationPhase = fmod(fmod(automationPhase, 10.0f) + 10.0f, 10.0f);
+	}
+	else if (automationMode == AUTOMATION_MODE_LINEAR)
+	{
+		automationPhase = automationInput / 10.;
+	}
+
+	if (automationMode == AUTOMATION_MODE_LINEAR && lastAutomationIn == automationInput)
+	{
+		// output[0] = output[1] = 0.0;
+		// skipProcessing = true;
+	}
+
+	// Fixed point so long buffers keep the fractional read position
+	SampleInterpolation::Position position(automationPhase, samples[0].size());
+	long readIndex = position.index();
+	float readFraction = position.fraction();
+ 	// For BufferWidget
+	this->outputIndex = readIndex;
+
+	// anti clicking filter
+	// change "maxSpeed4Filter" with something better
+	{
+		float indexDif = std::fabs(
+			static_cast<long long>(this->lastOutputIndex) -
+			static_cast<long long>(this->outputIndex));
+
+		if (antiClickFilter && in.sampleRate != 0 &&
+			this->lastOutputIndex != -1 &&
+			indexDif > samples[0].size() / in.sampleRate * maxSpeed4Filter)
+		{
+			fadeGain = 0.0f;
+			fadeCounter = (in.sampleRate / 1000) * this->rampSamplesMs;
+		}
+	}
+
+	if (!samples[0].empty() && !skipProcessing && recordingIndex >= (long long)samples[0].size())
+		recordingIndex = 0;
+
+	bool newPass = enableOverdub && recordingIndex < lastRecordingIndex;
+	lastRecordingIndex = recordingIndex;
+
+	if (!skipProcessing)
+		exporter.process(samples, recordingIndex);
+
+	int currentInterpolationMode = getInterpolationMode();
+
+	// Multitap heads are shared by both channels
+	long tapIndex[MAX_TAPS] = {};
+	float tapFraction[MAX_TAPS] = {};
+	for (int t = 0; t < tapCount && !samples[0].empty(); ++t)
+	{
+		float offset = tapOffset[t];
+		if (t < in.tapVoltageCount)
+			offset = std::min(std::max(in.tapVoltage[t] / 10.0f, 0.0f), 1.0f);
+
+		double size = samples[0].size();
+		SampleInterpolation::Position tapPosition((recordingIndex - offset * size) / size, samples[0].size());
+		tapIndex[t] = tapPosition.index();
+		tapFraction[t] = tapPosition.fraction();
+	}
+
+	if (spectralMode != lastSpectralMode)
+	{
+		for (SpectralProcessor &processor : spectral)
+			processor.reset();
+		lastSpectralMode = spectralMode;
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		SampleBuffer &vec = samples[i];
+		if (!vec.empty() && !skipProcessing)
+		{
+			if (recordingIndex >= (long long)vec.size())
+				recordingIndex = 0;
+
+			if (vec.feedback != overdubFeedback)
+				vec.setFeedback(overdubFeedback);
+			if (newPass)
+				vec.nextPass();
+
+			// Record for the buffer
+			if (in.audioConnected[i])
+			{
+				if (enableOverdub)
+					vec.overdub(recordingIndex, in.audio[i]);
+				else
+					vec.write(recordingIndex, in.audio[i]);
+			}
+
+			switch (currentInterpolationMode)
+			{
+			case INTERPOLATION_MODE_OPTIMAL_8X:
+				output[i] = SampleInterpolation::optimal8X(vec, readIndex, readFraction);
+				break;
+			case INTERPOLATION_MODE_OPTIMAL_2X:
+				output[i] = SampleInterpolation::optimal2X(vec, readIndex, readFraction);
+				break;
+			case INTERPOLATION_MODE_OPTIMAL_32X:
+				output[i] = SampleInterpolation::optimal32X(vec, readIndex, readFraction);
+				break;
+			case INTERPOLATION_MODE_CUBIC:
+				output[i] = SampleInterpolation::cubic(vec, readIndex, readFraction);
+				break;
+			case INTERPOLATION_MODE_LINEAR:
+				output[i] = SampleInterpolation::linear(vec, readIndex, readFraction);
+				break;
+			case INTERPOLATION_MODE_NONE:
+				output[i] = SampleInterpolation::none(vec, readIndex, readFraction);
+				break;
+			default:
+				output[i] = 0;
+			}
+
+			if (tapCount > 0)
+				output[i] += readTaps(vec, tapIndex, tapFraction);
+		}
+
+		if (fadeCounter > 0)
+		{
+			fadeGain += 1.0f / ((in.sampleRate / 1000) * rampSamplesMs);
+			fadeCounter--;
+			output[i] = (output[i] * fadeGain);
+			output[i] += (lastOutput[i] * (1.0f - fadeGain));
+		}
+
+		if (spectralMode != SPECTRAL_MODE_OFF)
+			output[i] = spectral[i].process(output[i], spectralMode, automationInput / 10.0f);
+	}
+
+	// Update all Last-X variables
+	this->lastPhaseIn = in.phase;
+	this->lastAutomationIn = automationInput;
+	this->lastOutputIndex = this->outputIndex;
+	this->lmasterLength = this->masterLength;
+
+	for (int i = 0; i < 2; ++i)
+		this->lastOutput[i] = output[i];
+
+	// Get the dry output value
+	float dryOutput[2] = {0, 0};
+
+	for (int i = 0; i < 2; ++i)
+	{
+		if (samples[i].size())
+		{
+			float pos =
+				recordingIndex / ((float)(samples[i].size()) + GNOME_PLEASING_NUMBER);
+			dryOutput[i] = samples[i][(size_t)(pos * samples[i].size()) % samples[0].size()];
+		}
+
+		// Always filled, so turning a mode on doesn't drop the dry signal
+		float delayed = dryDelay[i][dryDelayPosition];
+		dryDelay[i][dryDelayPosition] = dryOutput[i];
+		if (spectralMode != SPECTRAL_MODE_OFF)
+			dryOutput[i] = delayed;
+
+		// Mix between dry and wet audio
+		float p = std::min(std::max(in.mix, 0.0f), 1.0f);
+		output[i] = p * output[i];
+		output[i] += (1 - p) * dryOutput[i];
+	}
+	dryDelayPosition = (dryDelayPosition + 1) % SpectralProcessor::LATENCY;
+
+	// Update time/frame
+	timeSinceStep += in.sampleTime;
+	++lastResizeFrame;
+	++recordingIndex;
+
+	if (in.externalBpm && tempoTracker.period > 0)
+		bpmValue = tempoTracker.getBPM();
+	else if (masterLength != 0)
+		bpmValue = 60 / masterLength;
+
+	if (enableOutputFilter)
+	{
+		filteredOutput[0] = outFilter[0].process(output[0]);
+		filteredOutput[1] = outFilter[0].process(output[1]);
+	}
+	else
+	{
+		filteredOutput[0] = output[0];
+		filteredOutput[1] = output[1];
+	}
+
+	if (adaptiveQuality)
+		governor.end(in.sampleTime);
+}
+
+void SludgerEngine::initialize()
+{
+	bpmValue = -1;
+
+	masterLength = 0.5;
+	timeSinceStep = 0.0;
+	phaseOut = 0.0;
+
+	diffAdd = 0;
+	automationPhase = 0.0;
+
+	lmasterLength = -1;
+	lastPhaseIn = 0.0;
+	lastAutomationIn = 0.0;
+	lautomationPhase = 0.0;
+	lsampleRate = -1;
+
+	antiClickFilter = true;
+	fadeGain = 1.0f;
+	fadeCounter = 0;
+	this->lastOutputIndex = -1;
+	lastOutput[0] = lastOutput[1] = 0;
+	rampSamplesMs = 15;
+
+	firstBeat = true;
+
+	automationMode = AUTOMATION_MODE_LINEAR;
+	interpolationMode = INTERPOLATION_MODE_OPTIMAL_8X;
+	enableOutputFilter = true;
+	enableOverdub = false;
+	overdubFeedback = 0.8f;
+	compactStorage = false;
+	preservePitch = false;
+	adaptiveQuality = false;
+	tapCount = 0;
+	governor.budget = 0.05f;
+	governor.reset();
+	spectralMode = SPECTRAL_MODE_OFF;
+	for (std::vector<float> &delay : dryDelay)
+		std::fill(delay.begin(), delay.end(), 0.0f);
+	dryDelayPosition = 0;
+
+	recordingIndex = 0;
+	lastRecordingIndex = 0;
+	this->outputIndex = 0;
+}
@@ -0,0 +1,206 @@
+#ifndef _SLUDGER_ENGINE
+#define _SLUDGER_ENGINE
+
+#include <array>
+#include <vector>
+
+#include "MathUtils.hpp"
+#include "SampleBuffer.hpp"
+#include "SimdUtils.hpp"
+#include "TempoTracker.hpp"
+#include "SpectralProcessor.hpp"
+#include "BufferRebuilder.hpp"
+#include "BufferExporter.hpp"
+#include "QualityGovernor.hpp"
+
+// A value set with trial and error
+// Used to match the input audio when it is expected to via
+// automation. 
+
+// Trial and error number so the out audio will try to match 
+// the inputed audio instead of skipping forward. 
+// A better solution should be found since there is an audible
+// audio offset effect when dry input is enabled.
+constexpr int GNOME_PLEASING_NUMBER = 11;
+
+/**
+ * The record/playback core of BufferSludger without any Rack types, so
+ * it can also run headless (see tools/sludger_render.cpp).
+ * The module fills an Input from its ports and params every sample.
+ */
+struct SludgerEngine
+{
+	static const int AUTOMATION_MODE_LINEAR = 1;
+	static const int AUTOMATION_MODE_DERIVATIVE = 2;
+
+	static const int INTERPOLATION_MODE_NONE = 1;
+	static const int INTERPOLATION_MODE_LINEAR = 2;
+	static const int INTERPOLATION_MODE_CUBIC = 3;
+	static const int INTERPOLATION_MODE_OPTIMAL_2X = 4;
+	static const int INTERPOLATION_MODE_OPTIMAL_8X = 5;
+	static const int INTERPOLATION_MODE_OPTIMAL_32X = 6;
+
+	static const int MAX_TAPS = 4;
+
+	struct Input
+	{
+		float sampleRate = 44100.0f;
+		float sampleTime = 1.0f / 44100.0f;
+
+		float audio[2] = {0.0f, 0.0f};
+		bool audioConnected[2] = {false, false};
+
+		// Playback automation in volts, expanders already added
+		float automation = 0.0f;
+		// Multitap offsets in volts, the first tapVoltageCount override the menu
+		float tapVoltage[MAX_TAPS] = {};
+		int tapVoltageCount = 0;
+
+		float clear = 0.0f;
+		float reset = 0.0f;
+
+		bool externalBpm = false;
+		float bpm = 120.0f;
+		float step = 0.0f;
+		bool stepConnected = false;
+		float phase = 0.0f;
+		bool phaseConnected = false;
+
+		// Param plus CV, clamped to [0, 1] inside
+		float mix = 1.0f;
+	};
+
+	// Same thresholds as Rack's SchmittTrigger
+	struct Trigger
+	{
+		bool state = true;
+
+		bool process(float in)
+		{
+			if (state)
+			{
+				if (in <= 0.0f)
+					state = false;
+			}
+			else if (in >= 1.0f)
+			{
+				state = true;
+				return true;
+			}
+			return false;
+		}
+	};
+
+	Trigger clockTrigger;
+	Trigger resetTrigger;
+	Trigger clearBufferTrigger;
+
+	int bpmValue = -1;
+
+	float masterLength = 0.5;
+	// Smooths the external clock so jitter doesn't resize the buffer
+	TempoTracker tempoTracker;
+	float timeSinceStep = 0.0;
+	float phaseOut = 0.0;
+
+	float diffAdd = 0;
+	double automationPhase = 0.0;
+
+	// Keep stuff from last process
+	float lmasterLength = -1;
+	float lastPhaseIn = 0.0;
+	float lastAutomationIn = 0.0;
+	float lautomationPhase = 0.0;
+	int lsampleRate = -1;
+
+	// Anti Clicking Fader
+	bool antiClickFilter = true;
+	float fadeGain = 1.0f;
+	int fadeCounter = 0; // Samples passed since last click
+	long lastOutputIndex = -1;
+	float lastOutput[2];
+	float rampSamplesMs = 15;
+
+	bool isStereo = false;
+
+	// If audio plays at maxSpeed4Filter speed, assume its a click to filter it
+	const float maxSpeed4Filter = 32;
+
+	bool firstBeat = true;
+
+	int automationMode = AUTOMATION_MODE_LINEAR;
+	int8_t interpolationMode = INTERPOLATION_MODE_OPTIMAL_8X;
+	bool enableOutputFilter = true;
+	bool enableSpeedChange = false;
+
+	// Keep the pitch on speed changes, the stretched buffer is swapped in
+	// once it is built
+	bool preservePitch = false;
+	// Also converts the storage when compactStorage changes
+	BufferRebuilder rebuilder;
+
+	BufferExporter exporter;
+
+	// Extra read heads behind the recorder, summed into the wet output.
+	// Offsets are fractions of the buffer, Input::tapVoltage overrides them
+	int tapCount = 0;
+	float tapOffset[MAX_TAPS] = {0.25f, 0.5f, 0.75f, 0.125f};
+	float tapGain[MAX_TAPS] = {0.5f, 0.35f, 0.25f, 0.15f};
+
+	// Steps the interpolation down while process() is over cpuBudget
+	bool adaptiveQuality = false;
+	QualityGovernor governor;
+
+	// Sound on sound, older layers decay by overdubFeedback every pass
+	bool enableOverdub = false;
+	float overdubFeedback = 0.8f;
+
+	// Store samples as int16, see SampleBuffer. Converted by rebuilder
+	bool compactStorage = false;
+
+	// STFT effect on the wet output, driven by the automation input. Delays
+	// the wet output by SpectralProcessor::LATENCY, the dry output is
+	// played from dryDelay by as much while a mode is on
+	int spectralMode = SPECTRAL_MODE_OFF;
+	int lastSpectralMode = SPECTRAL_MODE_OFF;
+	SpectralProcessor spectral[2];
+	std::vector<float> dryDelay[2] = {
+		std::vector<float>(SpectralProcessor::LATENCY),
+		std::vector<float>(SpectralProcessor::LATENCY)};
+	int dryDelayPosition = 0;
+
+	long recordingIndex = 0;
+	long lastRecordingIndex = 0; // A smaller index starts a new overdub pass
+	long outputIndex = 0; // For ui only
+
+	std::array<SampleBuffer, 2> samples;
+	int lastResizeFrame = 0; // Avoid calling samples.resize too many times
+	int resizeCount = 0; // For the diagnostics overlay
+	float output[2] = {0.0, 0.0};
+	// output after the output filter, what goes to the jacks
+	float filteredOutput[2] = {0.0, 0.0};
+
+	LowPassFilter outFilter[2];
+
+	// Back to the default settings
+	void initialize();
+
+	void reset(bool resetFirstBeat = false);
+
+	// Feeds a clock interval to tempoTracker, true if masterLength changed
+	bool trackTempo(float interval);
+
+	void resizeBuffer(int sampleRate, bool disableSpeed = false);
+
+	void resizeBufferSpeed(long targetSampleCount);
+
+	void process(const Input &in);
+
+	// interpolationMode, or a cheaper one picked by the governor
+	int getInterpolationMode();
+
+	// Sum of the multitap heads for one channel
+	float readTaps(const SampleBuffer &buffer, const long *tapIndex, const float *tapFraction);
+};
+
+#endif // _SLUDGER_ENGINE
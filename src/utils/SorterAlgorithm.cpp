@@ -2,6 +2,9 @@
 
 #include "plugin.hpp"
 
+#include <algorithm>
+#include <chrono>
+
 static void debugPrint(const std::vector<int> &) __attribute__((unused));
 
 static void debugPrint(const std::vector<int> &array)
@@ -23,21 +26,148 @@ SelectedType::SelectedType(
 {
 }
 
-SorterArrayEvent::~SorterArrayEvent() {}
-
 SorterArrayEvent::SorterArrayEvent(
-    sorterarray_event_t eventType) : eventType(eventType)
+    sorterarray_event_t eventType, int valueA, int valueB)
+    : eventType(eventType), valueA(valueA), valueB(valueB)
+{
+    switch (eventType)
+    {
+    case SORTER_ARRAY_EVENT_CMP:
+        elementA = elementB = ELEMENT_EVENT_READ;
+        break;
+    case SORTER_ARRAY_EVENT_SWAP:
+        elementA = elementB = ELEMENT_EVENT_WRITE;
+        break;
+    case SORTER_ARRAY_EVENT_MOVE:
+        elementA = ELEMENT_EVENT_WRITE;
+        elementB = ELEMENT_EVENT_READ;
+        break;
+    case SORTER_ARRAY_EVENT_SET:
+        elementA = ELEMENT_EVENT_WRITE;
+        break;
+    case SORTER_ARRAY_EVENT_READ:
+        elementA = ELEMENT_EVENT_READ;
+        break;
+    case SORTER_ARRAY_EVENT_REMOVE:
+        elementA = ELEMENT_EVENT_REMOVE;
+        break;
+    default:
+        break;
+    }
+}
+
+int SorterArrayEvent::getElements(SelectedType out[2]) const
+{
+    int count = 0;
+    if (elementA != ELEMENT_EVENT_NONE)
+        out[count++] = SelectedType(elementA, valueA);
+    if (elementB != ELEMENT_EVENT_NONE)
+        out[count++] = SelectedType(elementB, valueB);
+    return count;
+}
+
+constexpr size_t SorterEventLog::CHUNK_SIZE;
+constexpr size_t SorterEventLog::MAX_CHUNKS;
+constexpr size_t SorterEventLog::STREAM_CHUNKS;
+constexpr size_t SorterEventLog::CHECKPOINT_BITS;
+constexpr size_t SorterEventLog::CHECKPOINT_INTERVAL;
+
+SorterEventLog::SorterEventLog()
+    : chunks(MAX_CHUNKS)
+{
+}
+
+void SorterEventLog::clear()
+{
+    // Reused chunks moved up the directory, bring them all to the start
+    size_t kept = 0;
+    for (size_t k = 0; k < directoryEnd; ++k)
+    {
+        if (!chunks[k])
+            continue;
+        if (k != kept)
+            chunks[kept] = std::move(chunks[k]);
+        ++kept;
+    }
+    directoryEnd = kept;
+
+    written = 0;
+    dropped = 0;
+    played = startPlayed;
+    firstKept = 0;
+    shadow = input;
+    publish();
+}
+
+bool SorterEventLog::beginChunk()
 {
+    size_t k = written >> CHUNK_BITS;
+    if (k >= MAX_CHUNKS)
+        return false;
+
+    if (!chunks[k])
+    {
+        if (allocated < keepChunks)
+        {
+            chunks[k].reset(new Chunk());
+            ++allocated;
+        }
+        else
+        {
+            // Sleeps until the reader has played the oldest chunk, another
+            // worker runs the pool's jobs meanwhile
+            size_t need = (dropped + 1) << CHUNK_BITS;
+            if (played.load() < need)
+            {
+                WorkerPool::beginBlocking();
+                {
+                    std::unique_lock<std::mutex> lock(parkMutex);
+                    wakeAt.store(need);
+                    while (played.load() < need && !(stopFlag && *stopFlag))
+                        parked.wait_for(lock, std::chrono::milliseconds(100));
+                    wakeAt.store(SIZE_MAX);
+                }
+                WorkerPool::endBlocking();
+
+                if (played.load() < need)
+                    return false;
+            }
+            firstKept.store((dropped + 1) << CHUNK_BITS, std::memory_order_release);
+            chunks[k] = std::move(chunks[dropped++]);
+        }
+    }
+
+    writing = chunks[k].get();
+    directoryEnd = std::max(directoryEnd, k + 1);
+    return true;
 }
 
-SorterArrayEvent::SorterArrayEvent()
+void SorterEventLog::saveCheckpoint(size_t slot)
 {
+    // Catches up in one pass, cheaper than following every push_back().
+    // Only swaps, moves and sets change the array
+    for (size_t i = written > CHECKPOINT_INTERVAL ? written - CHECKPOINT_INTERVAL : 0; i < written; ++i)
+    {
+        sorterarray_event_t eventType = type(i);
+        if (eventType >= SORTER_ARRAY_EVENT_SWAP && eventType <= SORTER_ARRAY_EVENT_SET)
+            apply((*this)[i], shadow);
+    }
+
+    // Sized once per chunk, reused chunks keep theirs
+    size_t size = shadow.size();
+    writing->checkpoints.resize(CHUNK_SIZE / CHECKPOINT_INTERVAL * size);
+    std::copy(shadow.begin(), shadow.end(), writing->checkpoints.begin() + slot * size);
 }
 
-void SorterArrayEvent::addElementEvent(elementevent_t elementEvent, int index)
+size_t SorterEventLog::bytes() const
 {
-    SelectedType s{elementEvent, index};
-    elements.push_back(s);
+    size_t total = chunks.capacity() * sizeof(chunks[0]);
+    for (const std::unique_ptr<Chunk> &chunk : chunks)
+    {
+        if (chunk)
+            total += sizeof(Chunk) + chunk->checkpoints.capacity() * sizeof(int);
+    }
+    return total;
 }
 
 SorterAlgorithm::SorterAlgorithm(
@@ -50,12 +180,7 @@ SorterAlgorithm::SorterAlgorithm(
 
 bool SorterAlgorithm::compare(int i, int j)
 {
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_CMP};
-    event.addElementEvent(ELEMENT_EVENT_READ, i);
-    event.addElementEvent(ELEMENT_EVENT_READ, j);
-    event.valueA = i;
-    event.valueB = j;
-    events.push_back(event);
+    events->push_back(SorterArrayEvent(SORTER_ARRAY_EVENT_CMP, i, j));
     return array[i] > array[j];
 }
 
@@ -64,50 +189,40 @@ void SorterAlgorithm::swap(int i, int j)
     int tmp = array[i];
     array[i] = array[j];
     array[j] = tmp;
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_SWAP};
-    event.addElementEvent(ELEMENT_EVENT_WRITE, i);
-    event.addElementEvent(ELEMENT_EVENT_WRITE, j);
-    event.valueA = i;
-    event.valueB = j;
-    events.push_back(event);
+    events->push_back(SorterArrayEvent(SORTER_ARRAY_EVENT_SWAP, i, j));
 }
 
 void SorterAlgorithm::move(int i, int j)
 {
+    SorterArrayEvent event(SORTER_ARRAY_EVENT_MOVE, i, j);
+    event.previous = array[i];
     array[i] = array[j];
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_MOVE};
-    event.addElementEvent(ELEMENT_EVENT_WRITE, i);
-    event.addElementEvent(ELEMENT_EVENT_READ, j);
-    event.valueA = i;
-    event.valueB = j;
-    events.push_back(event);
+    events->push_back(event);
 }
 
 void SorterAlgorithm::set(int i, int value)
 {
+    SorterArrayEvent event(SORTER_ARRAY_EVENT_SET, i, value);
+    event.previous = array[i];
     array[i] = value;
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_SET};
-    event.addElementEvent(ELEMENT_EVENT_WRITE, i);
-    event.valueA = i;
-    event.valueB = value;
-    events.push_back(event);
+    events->push_back(event);
 }
 
 int SorterAlgorithm::read(int i)
 {
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_SET};
-    event.addElementEvent(ELEMENT_EVENT_READ, i);
-    event.valueA = i;
-    event.valueB = array[i];
-    events.push_back(event);
+    // Recorded as a set of the same value, highlighted as a read
+    SorterArrayEvent event(SORTER_ARRAY_EVENT_SET, i, array[i]);
+    event.elementA = ELEMENT_EVENT_READ;
+    event.previous = array[i];
+    events->push_back(event);
 
     return array[i];
 }
 
 void SorterAlgorithm::end()
 {
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_END};
-    events.push_back(event);
+    events->push_back(SorterArrayEvent(SORTER_ARRAY_EVENT_END));
+    events->publish();
 }
 
 // Bubble Sort
@@ -153,7 +268,7 @@ InsertionSort::InsertionSort() : SorterAlgorithm("Insertion Sort", t_algorithmty
 void InsertionSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = (int)array.size();
     for (int i = 1; i < n; ++i)
     {
@@ -176,14 +291,14 @@ void InsertionSort::calculate(std::vector<int> arrayParam)
 
 // Binary Insertion Sort
 
-BinaryInsertionSort::BinaryInsertionSort() : SorterAlgorithm("Binary Insertion", t_algorithmtype::INSERTION)
+BinaryInsertionSort::BinaryInsertionSort() : SorterAlgorithm("Binary Insertion", t_algorithmtype::BINARY_INSERTION)
 {
 }
 
 void BinaryInsertionSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = (int)array.size();
     for (int i = 1; i < n; ++i)
     {
@@ -231,7 +346,7 @@ SelectionSort::SelectionSort() : SorterAlgorithm("Selection Sort", t_algorithmty
 void SelectionSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = (int)array.size();
     for (int i = 0; i < n - 1; ++i)
     {
@@ -257,14 +372,14 @@ void SelectionSort::calculate(std::vector<int> arrayParam)
 
 // Double Selection Sort
 
-DoubleSelectionSort::DoubleSelectionSort() : SorterAlgorithm("Double Selection Sort", t_algorithmtype::SELECTION)
+DoubleSelectionSort::DoubleSelectionSort() : SorterAlgorithm("Double Selection Sort", t_algorithmtype::DOUBLE_SELECTION)
 {
 }
 
 void DoubleSelectionSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -341,7 +456,7 @@ CocktailShakerSort::CocktailShakerSort() : SorterAlgorithm("Cocktail Shaker Sort
 void CocktailShakerSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -404,7 +519,7 @@ void MergeSort::reset()
 void MergeSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     std::vector<int> buffer(array.size());
     mergeSort(0, (int)array.size(), buffer);
     end();
@@ -483,7 +598,7 @@ CombSort::CombSort()
 void CombSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -532,7 +647,7 @@ GnomeSort::GnomeSort()
 void GnomeSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -578,7 +693,7 @@ OptimizedGnomeSort::OptimizedGnomeSort()
 void OptimizedGnomeSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -638,7 +753,7 @@ OddEvenSort::OddEvenSort()
 void OddEvenSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -695,7 +810,7 @@ ShellSort::ShellSort()
 void ShellSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -759,7 +874,7 @@ void HeapSort::heapify(int n, int i)
 void HeapSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -851,7 +966,7 @@ void SmoothSort::heapify(int start, int end)
 void SmoothSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
 
     int n = array.size();
     int p = n - 1;
@@ -941,7 +1056,7 @@ void BitonicSort::bitonicSort(int lo, int n, bool dir)
 void BitonicSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     bitonicSort(0, (int)array.size(), true);
     end();
 }
@@ -961,7 +1076,7 @@ void QuickSort::reset()
 void QuickSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     quickSort(0, (int)array.size() - 1);
     end();
 }
@@ -1057,7 +1172,7 @@ int BinaryQuickSort::partition(int p, int r, int bit)
 void BinaryQuickSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -1133,7 +1248,7 @@ RadixSortLSD::RadixSortLSD(
 void RadixSortLSD::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
 
     const int radixBase = this->base;
 
@@ -1186,7 +1301,7 @@ RadixSortMSD::RadixSortMSD(int base, t_algorithmtype type, std::string title)
 void RadixSortMSD::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
     int n = array.size();
     if (n <= 1)
     {
@@ -1322,7 +1437,7 @@ CycleSort::CycleSort()
 void CycleSort::calculate(std::vector<int> arrayParam)
 {
     array = std::move(arrayParam);
-    events.clear();
+    events->clear();
 
     int n = array.size();
 
@@ -1482,12 +1597,7 @@ SorterArrayEvent BogoSort::step(std::vector<int> &arrayParam)
     std::swap(arrayParam[i], arrayParam[j]);
     index++;
 
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_SWAP};
-    event.addElementEvent(ELEMENT_EVENT_WRITE, i);
-    event.addElementEvent(ELEMENT_EVENT_WRITE, j);
-    event.valueA = i;
-    event.valueB = j;
-    return event;
+    return SorterArrayEvent(SORTER_ARRAY_EVENT_SWAP, i, j);
 }
 
 bool BogoSort::isSorted(std::vector<int> &arrayParam)
@@ -1551,20 +1661,10 @@ SorterArrayEvent ExchangeBogoSort::step(std::vector<int> &arrayParam)
     {
         std::swap(arrayParam[i], arrayParam[j]);
 
-        SorterArrayEvent event{SORTER_ARRAY_EVENT_SWAP};
-        event.addElementEvent(ELEMENT_EVENT_WRITE, i);
-        event.addElementEvent(ELEMENT_EVENT_WRITE, j);
-        event.valueA = i;
-        event.valueB = j;
-        return event;
+        return SorterArrayEvent(SORTER_ARRAY_EVENT_SWAP, i, j);
     }
 
-    SorterArrayEvent event{SORTER_ARRAY_EVENT_CMP};
-    event.addElementEvent(ELEMENT_EVENT_READ, i);
-    event.addElementEvent(ELEMENT_EVENT_READ, j);
-    event.valueA = i;
-    event.valueB = j;
-    return event;
+    return SorterArrayEvent(SORTER_ARRAY_EVENT_CMP, i, j);
 }
 
 bool ExchangeBogoSort::isSorted(std::vector<int> &arrayParam)
@@ -1616,20 +1716,14 @@ SorterArrayEvent StalinSort::step(std::vector<int> &arrayParam)
 
     if (arrayParam[index] <= arrayParam[index + 1])
     {
-        SorterArrayEvent event{SORTER_ARRAY_EVENT_CMP};
-        event.addElementEvent(ELEMENT_EVENT_READ, index);
-        event.addElementEvent(ELEMENT_EVENT_READ, index + 1);
-        event.valueA = index;
-        event.valueB = index + 1;
+        SorterArrayEvent event(SORTER_ARRAY_EVENT_CMP, index, index + 1);
 
         ++index;
         return event;
     }
     else
     {
-        SorterArrayEvent event{SORTER_ARRAY_EVENT_REMOVE};
-        event.addElementEvent(ELEMENT_EVENT_REMOVE, index + 1);
-        event.valueA = index + 1;
+        SorterArrayEvent event(SORTER_ARRAY_EVENT_REMOVE, index + 1);
 
         arrayParam.erase(arrayParam.begin() + index + 1);
         return event;
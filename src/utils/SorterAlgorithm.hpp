@@ -1,7 +1,13 @@
 #ifndef _SORTER_ALGORITHM
 #define _SORTER_ALGORITHM
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 #include <random>
 #include <queue>
@@ -87,32 +93,275 @@ struct SelectedType
     }
 };
 
+/**
+ * One recorded operation, trivially copyable so logs never allocate per
+ * event. valueA is always an index, valueB is an index or, for
+ * SORTER_ARRAY_EVENT_SET, the value written. elementA and elementB say
+ * how the indices are touched, the highlights are derived from them.
+ * previous is what a move or a set overwrote at valueA, so every event
+ * can be undone, a swap undoes itself.
+ */
 struct SorterArrayEvent
 {
-    sorterarray_event_t eventType = 0;
-    std::vector<SelectedType> elements;
+    uint8_t eventType = SORTER_ARRAY_EVENT_NONE;
+    uint8_t elementA = ELEMENT_EVENT_NONE;
+    uint8_t elementB = ELEMENT_EVENT_NONE; // NONE when valueB isn't an index
     int valueA = 0;
     int valueB = 0;
+    int previous = 0;
 
-    ~SorterArrayEvent();
-
-    SorterArrayEvent();
+    SorterArrayEvent()
+    {
+    }
 
+    // The element events default to what eventType does to the array
     SorterArrayEvent(
-        sorterarray_event_t eventType);
+        sorterarray_event_t eventType, int valueA = 0, int valueB = 0);
+
+    // Writes up to 2 highlights to out, returns how many
+    int getElements(SelectedType out[2]) const;
+};
+
+/**
+ * Append only structure of arrays log of SorterArrayEvent, 14 bytes per
+ * event. Events are copied out by value.
+ *
+ * Events are stored in chunks that never move, so the worker can record
+ * while the audio thread plays what is already there. Only one thread
+ * writes, size() is what it has published: every full chunk and whatever
+ * is left at publish(). Chunks are kept by clear() for the next run.
+ *
+ * Past keepChunks the writer reuses the oldest chunk the reader has
+ * played, waiting in push_back() until there is one. Memory then stays
+ * bounded whatever the length of the sort, the worker only runs as far
+ * ahead as the playback, and events before first() are gone. The waiting
+ * writer sleeps on a condition variable that setPlayed() signals, and
+ * hands its WorkerPool worker over meanwhile.
+ *
+ * Given the input with setInput(), every CHECKPOINT_INTERVAL events the
+ * log keeps a copy of the array as it is before that event. Any event of
+ * a finished log is then reached by restoring a checkpoint and applying
+ * at most CHECKPOINT_INTERVAL events.
+ */
+struct SorterEventLog
+{
+    static constexpr size_t CHUNK_BITS = 14;
+    static constexpr size_t CHUNK_SIZE = 1 << CHUNK_BITS; // 224KB
+    // 64M events, far over what MAX_ARRAY_SIZE elements take to sort
+    static constexpr size_t MAX_CHUNKS = 4096;
+    // About 1M events, every algorithm but Cycle Sort fits at 1000 elements
+    static constexpr size_t STREAM_CHUNKS = 64;
+    // A seek applies up to 4096 events, checkpoints add 1KB per element
+    // and 1M events
+    static constexpr size_t CHECKPOINT_BITS = 12;
+    static constexpr size_t CHECKPOINT_INTERVAL = 1 << CHECKPOINT_BITS;
+
+    struct Chunk
+    {
+        uint8_t types[CHUNK_SIZE];
+        uint8_t elements[CHUNK_SIZE]; // elementA | elementB << 4
+        int32_t valuesA[CHUNK_SIZE];
+        int32_t valuesB[CHUNK_SIZE];
+        int32_t previous[CHUNK_SIZE];
+        // One array per CHECKPOINT_INTERVAL events, one after the other
+        std::vector<int> checkpoints;
+    };
+
+    SorterEventLog();
+
+    SorterEventLog(const SorterEventLog &) = delete;
+    SorterEventLog &operator=(const SorterEventLog &) = delete;
+
+    // Chunks allocated before played ones are reused, set with no writer
+    size_t keepChunks = MAX_CHUNKS;
+    // Stops a writer waiting for the reader, see wake()
+    volatile std::atomic<bool> *stopFlag = nullptr;
+
+    // Events the reader may use, call from the reader
+    size_t size() const
+    {
+        return published.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // Oldest event still held
+    size_t first() const
+    {
+        return firstKept.load(std::memory_order_acquire);
+    }
+
+    // Reader only, events before i won't be read again. Only the writer
+    // waits on it, so readers of a finished shared log may all call it
+    void setPlayed(size_t i) const
+    {
+        played.store(i);
+        if (i >= wakeAt.load())
+            wake();
+    }
+
+    // Has a waiting writer check played and stopFlag again. Never blocks,
+    // a wake that comes just before the writer sleeps is caught up by its
+    // timeout
+    void wake() const
+    {
+        std::unique_lock<std::mutex> lock(parkMutex, std::try_to_lock);
+        parked.notify_one();
+    }
+
+    sorterarray_event_t type(size_t i) const
+    {
+        return chunks[i >> CHUNK_BITS]->types[i & (CHUNK_SIZE - 1)];
+    }
 
-    void addElementEvent(elementevent_t elementEvent, int index);
+    // What playing event does to array, the writer follows the events with it
+    static void apply(const SorterArrayEvent &event, std::vector<int> &array)
+    {
+        int size = (int)array.size();
+        switch (event.eventType)
+        {
+        case SORTER_ARRAY_EVENT_SWAP:
+            if (0 <= event.valueA && event.valueA < size && 0 <= event.valueB && event.valueB < size)
+                std::swap(array[event.valueA], array[event.valueB]);
+            break;
+
+        case SORTER_ARRAY_EVENT_MOVE:
+            if (0 <= event.valueA && event.valueA < size && 0 <= event.valueB && event.valueB < size)
+                array[event.valueA] = array[event.valueB];
+            break;
+
+        case SORTER_ARRAY_EVENT_SET:
+            if (0 <= event.valueA && event.valueA < size)
+                array[event.valueA] = event.valueB;
+            break;
+
+        // REMOVE should be used only in non deterministic algorithms
+        default:
+            break;
+        }
+    }
 
-    const std::vector<SelectedType> &getElements() const
+    // Undoes apply()
+    static void revert(const SorterArrayEvent &event, std::vector<int> &array)
     {
-        return this->elements;
+        int size = (int)array.size();
+        switch (event.eventType)
+        {
+        case SORTER_ARRAY_EVENT_SWAP:
+            apply(event, array);
+            break;
+
+        case SORTER_ARRAY_EVENT_MOVE:
+        case SORTER_ARRAY_EVENT_SET:
+            if (0 <= event.valueA && event.valueA < size)
+                array[event.valueA] = event.previous;
+            break;
+
+        default:
+            break;
+        }
     }
+
+    // Reader only, writes the array before event i to out and returns i.
+    // i must be a multiple of CHECKPOINT_INTERVAL, from first() to under
+    // size()
+    size_t restore(size_t i, std::vector<int> &out) const
+    {
+        const Chunk &chunk = *chunks[i >> CHUNK_BITS];
+        size_t slot = (i & (CHUNK_SIZE - 1)) >> CHECKPOINT_BITS;
+        std::vector<int>::const_iterator begin = chunk.checkpoints.begin() + slot * input.size();
+        out.assign(begin, begin + input.size());
+        return i;
+    }
+
+    // Writer only, before the first event, kept by clear(). Events before
+    // start won't be read, the writer may drop them as if played
+    void setInput(const std::vector<int> &array, size_t start = 0)
+    {
+        input = array;
+        shadow = array;
+        startPlayed = start;
+        played = start;
+    }
+
+    SorterArrayEvent operator[](size_t i) const
+    {
+        const Chunk &chunk = *chunks[i >> CHUNK_BITS];
+        size_t j = i & (CHUNK_SIZE - 1);
+        SorterArrayEvent event;
+        event.eventType = chunk.types[j];
+        event.elementA = chunk.elements[j] & 0x0f;
+        event.elementB = chunk.elements[j] >> 4;
+        event.valueA = chunk.valuesA[j];
+        event.valueB = chunk.valuesB[j];
+        event.previous = chunk.previous[j];
+        return event;
+    }
+
+    // Writer only, dropped once MAX_CHUNKS are full or on stopFlag
+    void push_back(const SorterArrayEvent &event)
+    {
+        size_t j = written & (CHUNK_SIZE - 1);
+        if (j == 0 && !beginChunk())
+            return;
+        if ((j & (CHECKPOINT_INTERVAL - 1)) == 0)
+            saveCheckpoint(j >> CHECKPOINT_BITS);
+
+        writing->types[j] = (uint8_t)event.eventType;
+        writing->elements[j] = (uint8_t)(event.elementA | event.elementB << 4);
+        writing->valuesA[j] = event.valueA;
+        writing->valuesB[j] = event.valueB;
+        writing->previous[j] = event.previous;
+
+        if ((++written & (CHUNK_SIZE - 1)) == 0)
+            publish();
+    }
+
+    // Makes the events of the last partial chunk readable
+    void publish()
+    {
+        published.store(written, std::memory_order_release);
+    }
+
+    // Writer only, or with no writer running
+    void clear();
+
+    // Heap held by the log
+    size_t bytes() const;
+
+private:
+    // Indexed by chunk number, MAX_CHUNKS and never resized
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    Chunk *writing = nullptr;
+    size_t written = 0;
+    size_t allocated = 0;
+    size_t directoryEnd = 0; // Past the last chunk in the directory
+    size_t dropped = 0; // Chunks reused for later events
+    std::atomic<size_t> published{0};
+    mutable std::atomic<size_t> played{0};
+    size_t startPlayed = 0; // What clear() sets played to
+    // What played must reach for the waiting writer, SIZE_MAX with none
+    std::atomic<size_t> wakeAt{SIZE_MAX};
+    mutable std::mutex parkMutex;
+    mutable std::condition_variable parked;
+    std::atomic<size_t> firstKept{0};
+    std::vector<int> input;
+    std::vector<int> shadow; // input with the events before written applied
+
+    // Points writing at the chunk of the next event, false to drop it
+    bool beginChunk();
+
+    void saveCheckpoint(size_t slot);
 };
 
 struct SorterAlgorithm
 {
     std::vector<int> array;
-    std::vector<SorterArrayEvent> events;
+    // Set by the owner like externalStopFlag, calculate() records here
+    SorterEventLog *events = nullptr;
 
     std::string name;
     t_algorithmtype type;
@@ -121,8 +370,8 @@ struct SorterAlgorithm
 
     virtual void reset()
     {
+        // The log belongs to the owner, a running job may be writing it
         array.clear();
-        events.clear();
     }
 
     virtual void calculate(std::vector<int> arrayParam)
@@ -158,11 +407,6 @@ struct SorterAlgorithm
     {
         return precalculate;
     }
-
-    std::vector<SorterArrayEvent> &&getEvents()
-    {
-        return std::move(events);
-    }
 };
 
 // Bubble Sort
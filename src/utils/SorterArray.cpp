@@ -1,4 +1,8 @@
 #include "SorterArray.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
 
 #if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)))
 #pragma GCC diagnostic push
@@ -7,6 +11,7 @@
 
 static std::string printArray(const std::vector<int> &) __attribute__((unused));
 
+
 static std::string printArray(const std::vector<int> &vec)
 {
     std::string str = "";
@@ -109,10 +114,11 @@ SorterArray::SorterArray()
     DEFINE_ALGORITHM(t_algorithmtype::TEST, TestSort);
     #endif
 
-    for (auto &algorithm : algorithms)
-    {
-        algorithm.second->externalStopFlag = &stopRequested;
-    }
+    ownedEvents.push_back(std::make_shared<SorterEventLog>());
+    events = ownedEvents.back().get();
+
+    // Starts the workers here rather than with the first calculation
+    WorkerPool::instance();
 
     changeAlgorithm(t_algorithmtype::BUBBLE);
 }
@@ -120,15 +126,18 @@ SorterArray::SorterArray()
 SorterArray::~SorterArray()
 {
     stopCalculating();
+    waitForJob();
+    ownedEvents.clear();
     for (auto &algorithm : algorithms)
         delete algorithm.second;
 }
 
 void SorterArray::shuffle()
 {
-    if (!processingFinished)
-        stopCalculating();
-    reset();
+    // Like reset(), but calculates once the array is shuffled
+    stopCalculating();
+    resetData();
+    resetArray();
     std::shuffle(array.begin(), array.end(), rng);
     calculate();
 }
@@ -176,12 +185,17 @@ void SorterArray::resetData()
     this->shuffleIndex = 0;
     this->section = SECTION_SHUFFLE;
 
-    this->events.clear();
+    // The log stops playing, it is replaced by the next calculation
+    ++generation;
     eventIndex = 0;
-    eventCurrent = nullptr;
+    setEventCurrent(nullptr);
 
     for (auto &algorithm : algorithms)
+    {
+        if (isJobRunning() && algorithm.second == jobAlgorithm)
+            continue;
         algorithm.second->reset();
+    }
 }
 
 void SorterArray::reset()
@@ -200,67 +214,148 @@ void SorterArray::reset(int size, int line, std::string source)
     calculate();
 }
 
-void SorterArray::startThread()
+void SorterArray::startJob()
 {
-    waitForThread();
+    // Copied, stepSort changes array while the worker runs
+    startJob(array, 0);
+}
 
-    // Reset control flags
-    stopRequested = false;
-    processingFinished = false;
+void SorterArray::startJob(const std::vector<int> &input, int cursor)
+{
+    // The last job's log is retired before this one can delete it
+    adoptPendingEvents();
 
-    // Create thread attributes
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    // The log being played stops, the job publishes the next
+    ++generation;
+    jobGeneration = generation;
+    eventIndex = cursor;
+    eventsPlayed = cursor;
+    workerInput = input;
 
-    // Create the thread
-    int result = pthread_create(&workerThread, &attr, &SorterArray::threadFunction, this);
-    pthread_attr_destroy(&attr);
+    jobAlgorithm = algorithm;
+    jobRetired = retiredEvents;
+    jobCursor = cursor;
+    retiredEvents = nullptr;
 
-    if (result == 0)
-    {
-        threadCreated = true;
-    }
-    else
+    job.context = this;
+    job.run = [](WorkerPool::Job &current)
     {
-        // Handle thread creation error
-        processingFinished = true;
-    }
+        SorterArray *sorter = static_cast<SorterArray *>(current.context);
+        sorter->processInThread(current, sorter->jobAlgorithm, sorter->jobRetired, sorter->jobCursor);
+    };
+    // A failed job publishes no log, the sort ends without events and the
+    // retired log waits for the next job
+    if (!WorkerPool::instance().submit(job))
+        retiredEvents = jobRetired;
 }
 
-void SorterArray::waitForThread()
+void SorterArray::waitForJob()
 {
-    if (threadCreated)
-    {
-        pthread_join(workerThread, NULL);
-        threadCreated = false;
-    }
+    WorkerPool::instance().wait(job);
+}
+
+bool SorterArray::isJobRunning() const
+{
+    return !job.finished;
 }
 
 void SorterArray::stopCalculating()
 {
-    if (!processingFinished)
+    if (isJobRunning())
     {
-        stopRequested = true;
-        waitForThread();
+        job.cancel();
+        // Out of a wait for the reader, the job's log is pending or playing
+        const SorterEventLog *recording = pendingEvents.load();
+        (recording ? recording : events.load())->wake();
     }
+    calculatePending = false;
+    processingFinished = true;
+    ++generation;
 }
 
-void *SorterArray::threadFunction(void *arg)
+void SorterArray::poll()
 {
-    SorterArray *instance = static_cast<SorterArray *>(arg);
-    instance->processInThread();
-    return NULL;
+    // Read first, a job that finished has published its log
+    bool running = isJobRunning();
+    if (pendingEvents.load(std::memory_order_relaxed))
+        adoptPendingEvents();
+
+    if (processingFinished || running)
+        return;
+
+    if (calculatePending)
+    {
+        calculatePending = false;
+        startJob();
+    }
+    else
+        processingFinished = true;
 }
 
-void SorterArray::processInThread()
+void SorterArray::processInThread(WorkerPool::Job &running, SorterAlgorithm *jobAlgorithm,
+                                  const SorterEventLog *retired, int cursor)
 {
-    // array is copied inside SorterAlgorithm::calculate
-    this->algorithm->calculate(array);
+    TRACE_SCOPE("SorterArray::processInThread");
 
-    this->events = this->algorithm->events;
-    this->eventIndex = 0;
-    this->processingFinished = true;
+    std::shared_ptr<SavedInput> saved = std::make_shared<SavedInput>();
+    saved->generation = jobGeneration;
+    saved->type = jobAlgorithm->type;
+    saved->input = workerInput;
+    std::atomic_store(&savedInput, std::shared_ptr<const SavedInput>(saved));
+
+    // retired can't be reached through events anymore, the audio thread
+    // is done with it
+    for (size_t i = 0; retired && i < ownedEvents.size(); ++i)
+    {
+        if (ownedEvents[i].get() == retired)
+        {
+            ownedEvents.erase(ownedEvents.begin() + i);
+            break;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    SorterLogCache &cache = SorterLogCache::instance();
+    SorterLogCache::LogPtr cached = cache.find(jobAlgorithm->type, workerInput);
+    if (cached)
+    {
+        ownedEvents.push_back(cached);
+        pendingEvents.store(cached.get(), std::memory_order_release);
+
+        this->eventCount = cached->size();
+        this->eventBytes = cached->bytes();
+        this->lastComputeMs = std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        return;
+    }
+
+    std::shared_ptr<SorterEventLog> log = std::make_shared<SorterEventLog>();
+    log->keepChunks = SorterEventLog::STREAM_CHUNKS;
+    // Nothing before the cursor plays, the worker drops it as it goes
+    log->setInput(workerInput, cursor);
+
+    // Every job stops on its own flag, a late cancel can't stop the next
+    jobAlgorithm->externalStopFlag = &running.cancelled;
+    log->stopFlag = &running.cancelled;
+    jobAlgorithm->events = log.get();
+    ownedEvents.push_back(log);
+    pendingEvents.store(log.get(), std::memory_order_release);
+
+    jobAlgorithm->calculate(workerInput);
+    log->publish();
+    jobAlgorithm->events = nullptr;
+
+    // A log that dropped its start or was cut short can't be played again
+    log->stopFlag = nullptr;
+    if (!running.cancelled && log->first() == 0)
+        cache.insert(jobAlgorithm->type, workerInput, log);
+
+    // poll() notices the job finished on the audio thread
+    this->eventCount = log->size();
+    this->eventBytes = log->bytes();
+    this->lastComputeMs = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
 }
 
 void SorterArray::calculate()
@@ -270,29 +365,86 @@ void SorterArray::calculate()
         return;
    // DEBUG("wetfftwtfw %d %d", __LINE__, (int)processingFinished);
 
-    stopRequested = false;
-
     if (algorithm)
     {
-        algorithm->events.clear();
         if (algorithm->doPrecompute())
         {
-            startThread();
+            processingFinished = false;
+            // A cancelled job still uses the algorithms, poll() starts this after it
+            if (isJobRunning())
+            {
+                eventIndex = 0;
+                calculatePending = true;
+            }
+            else
+                startJob();
         }
         else
         {
+            ++generation;
             this->processingFinished = true;
         }
     }
 }
 
+void SorterArray::adoptPendingEvents()
+{
+    const SorterEventLog *fresh = pendingEvents.exchange(nullptr, std::memory_order_acquire);
+    if (!fresh)
+        return;
+
+    // One log is published per job and startJob() hands the retired one
+    // over first, so the slot is always free here
+    retiredEvents = events.exchange(fresh);
+    eventsGeneration = jobGeneration;
+}
+
+int SorterArray::playableEvents() const
+{
+    return eventsGeneration == generation ? (int)events.load(std::memory_order_relaxed)->size() : 0;
+}
+
+void SorterArray::setEventCurrent(SorterArrayEvent *event)
+{
+    eventCurrent = event;
+    if (!event)
+    {
+        displayEvent.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t packed = (uint64_t)event->eventType | (uint64_t)event->elementA << 8 |
+                      (uint64_t)event->elementB << 12 |
+                      (uint64_t)(event->valueA & 0xffffff) << 16 |
+                      (uint64_t)(event->valueB & 0xffffff) << 40;
+    // Flags it as set, a NONE event packs to 0 otherwise
+    displayEvent.store(packed | (uint64_t)1 << 7, std::memory_order_relaxed);
+}
+
+bool SorterArray::getDisplayEvent(SorterArrayEvent &out) const
+{
+    uint64_t packed = displayEvent.load(std::memory_order_relaxed);
+    if (!packed)
+        return false;
+
+    out.eventType = packed & 0x7f;
+    out.elementA = (packed >> 8) & 0x0f;
+    out.elementB = (packed >> 12) & 0x0f;
+    out.valueA = (int)((packed >> 16) & 0xffffff);
+    out.valueB = (int)((packed >> 40) & 0xffffff);
+    return true;
+}
+
 SorterArrayEvent *SorterArray::step()
 {
-    if (!processingFinished)
-        return nullptr;
+    poll();
 
     if (section == SECTION_SHUFFLE)
     {
+        // The shuffle can't start a new calculation before the last ends
+        if (!processingFinished)
+            return nullptr;
+
         if (isDoneShuffle())
         {
             shuffleIndex = 0;
@@ -304,11 +456,7 @@ SorterArrayEvent *SorterArray::step()
             return stepShuffle();
     }
 
-    if (!processingFinished)
-    {
-        return nullptr;
-    }
-
+    // The sort plays events as soon as the worker publishes them
     if (section == SECTION_STEP)
     {
         bool doneBool = isDoneSort();
@@ -342,6 +490,7 @@ SorterArrayEvent *SorterArray::step()
 
 SorterArrayEvent *SorterArray::stepShuffle()
 {
+    poll();
     if (!processingFinished)
         return nullptr;
 
@@ -364,15 +513,8 @@ SorterArrayEvent *SorterArray::stepShuffle()
     }
 
     {
-        eventLocal.eventType = SORTER_ARRAY_EVENT_SWAP;
-        eventLocal.valueA = shuffleIndex;
-
         std::uniform_int_distribution<int> int_dist(0, array.size() - 1);
-        eventLocal.valueB = int_dist(rng);
-
-        eventLocal.elements = {
-            SelectedType{ELEMENT_EVENT_WRITE, shuffleIndex},
-            SelectedType{ELEMENT_EVENT_WRITE, eventLocal.valueB}};
+        eventLocal = SorterArrayEvent(SORTER_ARRAY_EVENT_SWAP, shuffleIndex, int_dist(rng));
 
         int tmp = array[shuffleIndex];
         array[shuffleIndex] = array[eventLocal.valueB];
@@ -380,21 +522,20 @@ SorterArrayEvent *SorterArray::stepShuffle()
 
         ++shuffleIndex;
 
-        eventCurrent = &eventLocal;
+        setEventCurrent(&eventLocal);
         return &eventLocal;
     }
 
     return nullptr;
 }
 
-#define IS_BETWEEN(x, s) (0 <= (int)x && (int)x < (int)s)
-
 SorterArrayEvent *SorterArray::stepSort()
 {
+    poll();
     if (!algorithm->doPrecompute())
     {
         eventLocal = algorithm->step(array);
-        this->eventCurrent = &eventLocal;
+        setEventCurrent(&eventLocal);
         if (this->eventCurrent->eventType == SORTER_ARRAY_EVENT_END)
         {
             tSort = true;
@@ -407,13 +548,21 @@ SorterArrayEvent *SorterArray::stepSort()
         return &eventLocal;
     }
 
-    if (!processingFinished || events.empty())
+    // poll() only sets finished after the last publish, the size is final
+    bool finished = processingFinished;
+    int available = playableEvents();
+
+    // Waiting for the worker to get further
+    if (!finished && eventIndex >= available)
+        return nullptr;
+
+    if (available == 0)
         return nullptr;
 
-    if (eventIndex >= (int)this->events.size())
+    if (eventIndex >= available)
     {
-        // DEBUG("q3y3q4yffy: %d %d", (int)eventIndex, (int)this->events.size());
-        calculate();
+        // The finished log is kept for seeking and stepping back, only a
+        // shuffle or a recalculate starts the next one
         tSort = true;
         return nullptr;
     }
@@ -424,57 +573,121 @@ SorterArrayEvent *SorterArray::stepSort()
     this->shuffleFrames = 0;
     this->traverseFrames = 0;
 
-    while (eventIndex < (int)this->events.size())
+    const SorterEventLog &log = *events.load(std::memory_order_relaxed);
+    while (eventIndex < available)
     {
-        SorterArrayEvent &event = this->events[eventIndex++];
-        this->eventCurrent = &event;
+        eventLocal = log[eventIndex++];
+        setPlayed(log);
+        SorterArrayEvent &event = eventLocal;
+        setEventCurrent(&eventLocal);
+        SorterEventLog::apply(event, array);
 
-        switch (event.eventType)
-        {
-        case SORTER_ARRAY_EVENT_NONE:
-        case SORTER_ARRAY_EVENT_CMP:
-        case SORTER_ARRAY_EVENT_READ:
-            break;
-
-        case SORTER_ARRAY_EVENT_SWAP:
+        if (filterEvent[event.eventType])
         {
-            if (IS_BETWEEN(event.valueA, array.size()) && IS_BETWEEN(event.valueB, array.size()))
-            {
-                int tmp = array[event.valueA];
-                array[event.valueA] = array[event.valueB];
-                array[event.valueB] = tmp;
-            }
+            continue;
         }
-        break;
 
-        case SORTER_ARRAY_EVENT_MOVE:
-            if (IS_BETWEEN(event.valueA, array.size()) && IS_BETWEEN(event.valueB, array.size()))
-                array[event.valueA] = array[event.valueB];
-            break;
+        return &event;
+    }
 
-        case SORTER_ARRAY_EVENT_SET:
-            if (IS_BETWEEN(event.valueA, array.size()))
-                array[event.valueA] = event.valueB;
-            break;
+    return nullptr;
+}
 
-        case SORTER_ARRAY_EVENT_REMOVE:
-            // Should be used only in non deterministic algorithms
-            break;
-        }
+SorterArrayEvent *SorterArray::seek(int target)
+{
+    poll();
+    int available = playableEvents();
+    if (!algorithm->doPrecompute() || available == 0)
+        return nullptr;
 
-        if (filterEvent[event.eventType])
-        {
+    // A cursor restored past what the worker has published has nothing to
+    // seek through yet, its checkpoint isn't recorded
+    if (!processingFinished && eventIndex >= available)
+        return nullptr;
+
+    // Chunks behind the cursor are reused while the worker records
+    const SorterEventLog &log = *events.load(std::memory_order_relaxed);
+    int first = processingFinished ? (int)log.first() : std::min(std::max(eventIndex, 0), available - 1);
+    target = std::min(std::max(target, first), available);
+    if (target == eventIndex && section == SECTION_STEP)
+        return nullptr;
+    if (!processingFinished && section != SECTION_STEP)
+        return nullptr;
+
+    int interval = (int)SorterEventLog::CHECKPOINT_INTERVAL;
+    if (target < eventIndex || target - eventIndex > interval || section != SECTION_STEP)
+    {
+        // The checkpoint at available is made with the next event
+        int checkpoint = std::max(std::min(target, available - 1), first) & ~(interval - 1);
+        eventIndex = (int)log.restore(checkpoint, array);
+    }
+
+    this->section = SECTION_STEP;
+    this->traversalIndex = 0;
+    this->shuffleIndex = 0;
+    this->shuffleFrames = 0;
+    this->traverseFrames = 0;
+
+    if (eventIndex == target)
+    {
+        setEventCurrent(nullptr);
+        return nullptr;
+    }
+
+    while (eventIndex < target)
+    {
+        eventLocal = log[eventIndex++];
+        SorterEventLog::apply(eventLocal, array);
+    }
+    setPlayed(log);
+    setEventCurrent(&eventLocal);
+    return &eventLocal;
+}
+
+SorterArrayEvent *SorterArray::stepSortBack()
+{
+    poll();
+    int available = playableEvents();
+    if (!algorithm->doPrecompute() || available == 0 || section < SECTION_STEP)
+        return nullptr;
+
+    const SorterEventLog &log = *events.load(std::memory_order_relaxed);
+    int first = (int)log.first();
+    if (!processingFinished)
+        first = std::max(first, eventsPlayed & ~(int)(SorterEventLog::CHUNK_SIZE - 1));
+
+    // The traversal and the end leave the array as the sort did
+    this->section = SECTION_STEP;
+    this->traversalIndex = 0;
+    this->traverseFrames = 0;
+
+    eventIndex = std::min(eventIndex, available);
+    while (eventIndex > first)
+    {
+        eventLocal = log[--eventIndex];
+        SorterEventLog::revert(eventLocal, array);
+        setEventCurrent(&eventLocal);
+
+        if (eventLocal.eventType == SORTER_ARRAY_EVENT_END || filterEvent[eventLocal.eventType])
             continue;
-        }
 
-        return &event;
+        return &eventLocal;
     }
 
     return nullptr;
 }
 
+void SorterArray::setPlayed(const SorterEventLog &log)
+{
+    // Stepping back doesn't lower it, the worker may already have
+    // reused what's behind
+    eventsPlayed = std::max(eventsPlayed, eventIndex);
+    log.setPlayed(eventsPlayed);
+}
+
 SorterArrayEvent *SorterArray::stepTraverse()
 {
+    poll();
     if (!processingFinished)
         return nullptr;
 
@@ -494,15 +707,11 @@ SorterArrayEvent *SorterArray::stepTraverse()
         tTraverse = true;
     }
 
-    eventLocal.eventType = SORTER_ARRAY_EVENT_READ;
-    eventLocal.valueA = traversalIndex;
-
-    eventLocal.elements = {
-        SelectedType{ELEMENT_EVENT_READ, traversalIndex}};
+    eventLocal = SorterArrayEvent(SORTER_ARRAY_EVENT_READ, traversalIndex);
 
     ++traversalIndex;
 
-    eventCurrent = &eventLocal;
+    setEventCurrent(&eventLocal);
     return &eventLocal;
 }
 
@@ -518,29 +727,26 @@ bool SorterArray::isDoneShuffle()
 
 bool SorterArray::isDoneSort()
 {
-    if (!processingFinished)
-        return false;
-
     if (array.empty())
         return true;
 
     if (algorithm->doPrecompute())
     {
-        if (events.empty() ||
-            eventIndex < 0 ||
-            eventIndex >= (int)events.size())
-        {
-            return true;
-        }
+        bool finished = processingFinished;
+        int available = playableEvents();
+
+        // Past the published events the sort is only done without a worker
+        if (eventIndex < 0 || eventIndex >= available)
+            return finished;
 
-        if (events[eventIndex].eventType == SORTER_ARRAY_EVENT_END)
+        if (events.load(std::memory_order_relaxed)->type(eventIndex) == SORTER_ARRAY_EVENT_END)
         {
             return true;
         }
     }
     else
     {
-        if (!eventCurrent)
+        if (!processingFinished || !eventCurrent)
             return false;
 
         if (eventCurrent->eventType == SORTER_ARRAY_EVENT_END)
@@ -627,31 +833,17 @@ json_t *SorterArray::toJson()
     // serialize the scale object
     json_object_set_new(root, "outScale", outScale.toJson());
 
-    // serialize events vector std::vector<SorterArrayEvent>
-    json_t *eventsJson = json_array();
-    for (const SorterArrayEvent &event : events)
+    // The log isn't saved, the algorithms are deterministic so fromJson()
+    // sorts the input again and plays from eventIndex on
+    std::shared_ptr<const SavedInput> saved = std::atomic_load(&savedInput);
+    bool current = saved && saved->generation == generation && saved->type == currentType;
+    if (section == SECTION_STEP && algorithm->doPrecompute() && current)
     {
-        json_t *eventObj = json_object();
-
-        // Serialize primitive members
-        json_object_set_new(eventObj, "eventType", json_integer(event.eventType));
-        json_object_set_new(eventObj, "valueA", json_integer(event.valueA));
-        json_object_set_new(eventObj, "valueB", json_integer(event.valueB));
-
-        // Serialize elements vector
-        json_t *elementsArray = json_array();
-        for (const SelectedType &element : event.getElements())
-        {
-            json_t *elementObj = json_object();
-            json_object_set_new(elementObj, "event", json_integer(element.getEvent()));
-            json_object_set_new(elementObj, "index", json_integer(element.getIndex()));
-            json_array_append_new(elementsArray, elementObj);
-        }
-        json_object_set_new(eventObj, "elements", elementsArray);
-
-        json_array_append_new(eventsJson, eventObj);
+        json_t *initialJson = json_array();
+        for (int value : saved->input)
+            json_array_append_new(initialJson, json_integer(value));
+        json_object_set_new(root, "initialArray", initialJson);
     }
-    json_object_set_new(root, "events", eventsJson);
 
     // Serialize current algorithm type
     json_object_set_new(root, "outScale", outScale.toJson());
@@ -739,40 +931,11 @@ void SorterArray::fromJson(json_t *rootJ)
     if (j_outScale)
         outScale.fromJson(j_outScale); // Assumes fromJson()
 
-    // Deserialize std::vector<SorterArrayEvent> events
-    events.clear();
-    json_t *eventsArray = json_object_get(rootJ, "events");
-    if (eventsArray)
-    {
-        size_t eventIndex;
-        json_t *eventObj;
-        json_array_foreach(eventsArray, eventIndex, eventObj)
-        {
-            SorterArrayEvent event;
-
-            // Deserialize primitive members
-            event.eventType = json_integer_value(json_object_get(eventObj, "eventType"));
-            event.valueA = json_integer_value(json_object_get(eventObj, "valueA"));
-            event.valueB = json_integer_value(json_object_get(eventObj, "valueB"));
-
-            // Deserialize elements vector
-            json_t *elementsArray = json_object_get(eventObj, "elements");
-            if (elementsArray)
-            {
-                size_t elementIndex;
-                json_t *elementObj;
-                json_array_foreach(elementsArray, elementIndex, elementObj)
-                {
-                    SelectedType element;
-                    element.elementEvent = json_integer_value(json_object_get(elementObj, "event"));
-                    element.index = json_integer_value(json_object_get(elementObj, "index"));
-                    event.elements.push_back(element);
-                }
-            }
-
-            events.push_back(event);
-        }
-    }
+    // Patches saved with an "events" log load without it
+    stopCalculating();
+    waitForJob();
+    changeAlgorithm(currentType);
+    json_t *initialJson = json_object_get(rootJ, "initialArray");
 
     // Deserialize filterEvent array
     json_t *filterEventJson = json_object_get(rootJ, "filterEvent");
@@ -788,10 +951,24 @@ void SorterArray::fromJson(json_t *rootJ)
 
     // Reset transient state
     isFromJson = true; // Flag to handle post-load initialization
-    eventCurrent = nullptr;
+    setEventCurrent(nullptr);
     processingFinished = true;
 
-    waitForThread();
+    // Calculated in the background, the sort waits at the cursor until
+    // the worker gets there
+    if (initialJson && section == SECTION_STEP && algorithm->doPrecompute())
+    {
+        std::vector<int> initialArray;
+        size_t index;
+        json_t *value;
+        json_array_foreach(initialJson, index, value)
+        {
+            initialArray.push_back(json_integer_value(value));
+        }
+
+        processingFinished = false;
+        startJob(initialArray, std::max(eventIndex, 0));
+    }
 }
 
 // helper getters
@@ -8,6 +8,8 @@
 #include "plugin.hpp"
 
 #include "SorterAlgorithm.hpp"
+#include "SorterLogCache.hpp"
+#include "WorkerPool.hpp"
 
 #define AAAAA() DEBUG("%d", __LINE__)
 
@@ -41,6 +43,9 @@ struct SorterArray
     int traverseSkip = 1;
 
     int eventIndex = 0;
+    // Furthest event played in the current log, the worker may reuse the
+    // chunks before its chunk
+    int eventsPlayed = 0;
     // For stepShuffle and stepTraverse
     int shuffleIndex = 0;
     int traversalIndex = 0;
@@ -51,11 +56,36 @@ struct SorterArray
     Scale outScale{};
     int keyOffset{};
 
-    std::vector<SorterArrayEvent> events;
-
-    // Local event to be stored in SorterArrayEvent
-    SorterArrayEvent eventLocal = SorterArrayEvent(0);
+    // The log being played, never null. Every calculation takes a log from
+    // SorterLogCache or records into a new one, played while it records.
+    // Its job publishes it through pendingEvents. Long sorts are streamed
+    // through STREAM_CHUNKS
+    std::atomic<const SorterEventLog *> events{nullptr};
+    std::atomic<const SorterEventLog *> pendingEvents{nullptr};
+    // Only the audio thread reads the logs, a replaced log is released by
+    // the next job, never on the audio thread
+    const SorterEventLog *retiredEvents = nullptr;
+    // Owned by the jobs, a reference for every log published and not
+    // released yet, the same log may be published twice
+    std::vector<SorterLogCache::LogPtr> ownedEvents;
+    // What the worker sorts, array keeps being played meanwhile
+    std::vector<int> workerInput;
+    // Saved instead of the log, which is calculated again on load. Copied
+    // by every job as it starts, toJson() on the UI thread takes it with
+    // std::atomic_load()
+    struct SavedInput
+    {
+        uint32_t generation;
+        t_algorithmtype type;
+        std::vector<int> input;
+    };
+    std::shared_ptr<const SavedInput> savedInput;
+
+    // The event being played, copied out of the log or made by the step
+    SorterArrayEvent eventLocal;
     SorterArrayEvent *eventCurrent = nullptr;
+    // eventCurrent packed for the screen, see getDisplayEvent()
+    std::atomic<uint64_t> displayEvent{0};
 
     // state of the current algorithm
     t_algorithmtype currentType;
@@ -63,11 +93,27 @@ struct SorterArray
 
     std::mt19937 rng{};
 
-    //std::thread workerThread;
-    pthread_t workerThread{};
+    // The last calculation on the WorkerPool, it may still be returning
+    // from a cancel. Only one runs at a time, they share the algorithms,
+    // so the job is submitted again and takes its arguments from here
+    WorkerPool::Job job;
+    SorterAlgorithm *jobAlgorithm = nullptr;
+    const SorterEventLog *jobRetired = nullptr;
+    int jobCursor = 0;
+    // Bumped by every stop, events only play in the generation that
+    // started them. A cancelled job's events are never played
+    uint32_t generation = 0;
+    uint32_t eventsGeneration = 0;
+    uint32_t jobGeneration = 0;
+    // Starts once the cancelled job has returned
+    bool calculatePending = false;
+    // No calculation to wait for, only changed by the audio thread
     volatile std::atomic_bool processingFinished = ATOMIC_VAR_INIT(true);
-    volatile std::atomic_bool stopRequested =  ATOMIC_VAR_INIT(false);
-    bool threadCreated = false;
+
+    // For the diagnostics overlay, written by the worker
+    std::atomic<size_t> eventCount{0};
+    std::atomic<size_t> eventBytes{0};
+    std::atomic<float> lastComputeMs{0.0f};
     
    // std::future<void> workerFuture;
 
@@ -100,15 +146,36 @@ struct SorterArray
     void reset(int size, int line = -1, std::string source = "_");
 
 
-    void startThread();
+    void startJob();
+
+    // Sorts input instead of array, the log plays from cursor on
+    void startJob(const std::vector<int> &input, int cursor);
 
-    void waitForThread();
+    // Blocks, never from the audio thread
+    void waitForJob();
 
+    bool isJobRunning() const;
+
+    // Cancels without waiting
     void stopCalculating();
 
-    static void* threadFunction(void* arg);
+    // Call from the audio thread, picks up finished and pending jobs
+    void poll();
+
+    void processInThread(WorkerPool::Job &running, SorterAlgorithm *jobAlgorithm,
+                         const SorterEventLog *retired, int cursor);
+
+    // Plays the log the last job published, retires the one it replaces
+    void adoptPendingEvents();
 
-    void processInThread();
+    // Events of the current generation
+    int playableEvents() const;
+
+    void setEventCurrent(SorterArrayEvent *event);
+
+    // The event on the screen, false when there's none. Safe from any
+    // thread, indices over 24 bits are cut
+    bool getDisplayEvent(SorterArrayEvent &out) const;
 
 
 
@@ -120,6 +187,18 @@ struct SorterArray
 
     SorterArrayEvent *stepSort();
 
+    // Moves the sort to before event target of the precomputed log, from a
+    // checkpoint when it's far. Only forward while the worker records.
+    // Returns the last event played, filtered or not
+    SorterArrayEvent *seek(int target);
+
+    // Undoes the last event played, back into the sort from the traversal.
+    // Only within the chunk played last while the worker records
+    SorterArrayEvent *stepSortBack();
+
+    // Marks the log played up to eventIndex
+    void setPlayed(const SorterEventLog &log);
+
     SorterArrayEvent *stepTraverse();
 
     bool isDone();
@@ -0,0 +1,81 @@
+#include "SorterLogCache.hpp"
+
+constexpr size_t SorterLogCache::MAX_BYTES;
+
+SorterLogCache &SorterLogCache::instance()
+{
+	static SorterLogCache *cache = new SorterLogCache();
+	return *cache;
+}
+
+// FNV-1a over the type and the values
+uint64_t SorterLogCache::makeKey(t_algorithmtype type, const std::vector<int> &input)
+{
+	uint64_t hash = 14695981039346656037ull;
+	hash = (hash ^ (uint64_t)type) * 1099511628211ull;
+	for (int value : input)
+		hash = (hash ^ (uint32_t)value) * 1099511628211ull;
+	return hash;
+}
+
+SorterLogCache::LogPtr SorterLogCache::find(t_algorithmtype type, const std::vector<int> &input)
+{
+	uint64_t key = makeKey(type, input);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = index.find(key);
+	if (found == index.end())
+		return nullptr;
+
+	std::list<Entry>::iterator entry = found->second;
+	if (entry->type != type || entry->input != input)
+		return nullptr;
+
+	entries.splice(entries.begin(), entries, entry);
+	++hits;
+	return entry->log;
+}
+
+void SorterLogCache::insert(t_algorithmtype type, const std::vector<int> &input, LogPtr log)
+{
+	size_t logBytes = log->bytes();
+	if (logBytes > MAX_BYTES)
+		return;
+
+	uint64_t key = makeKey(type, input);
+	// Freed after the lock is released, the last owner frees a log
+	std::vector<LogPtr> dropped;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// A colliding key keeps the newest log
+		auto found = index.find(key);
+		if (found != index.end())
+		{
+			bytes -= found->second->bytes;
+			dropped.push_back(found->second->log);
+			entries.erase(found->second);
+			index.erase(found);
+		}
+
+		while (!entries.empty() && bytes + logBytes > MAX_BYTES)
+		{
+			Entry &oldest = entries.back();
+			bytes -= oldest.bytes;
+			dropped.push_back(oldest.log);
+			index.erase(oldest.key);
+			entries.pop_back();
+		}
+
+		Entry entry;
+		entry.key = key;
+		entry.type = type;
+		entry.input = input;
+		entry.log = log;
+		entry.bytes = logBytes;
+		entries.push_front(entry);
+		index[key] = entries.begin();
+		bytes += logBytes;
+		count = entries.size();
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef _SORTER_LOG_CACHE
+#define _SORTER_LOG_CACHE
+
+#include "SorterAlgorithm.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Plugin wide cache of finished event logs, so sorting an input again
+ * with the same algorithm plays at once. Shared by every SortStep, a log
+ * is kept by whoever plays it after it leaves the cache.
+ *
+ * Only complete logs go in, a streamed one that dropped its start can't
+ * be played again. The least recently used logs are dropped past
+ * MAX_BYTES. Called from the workers, never from the audio thread.
+ */
+struct SorterLogCache
+{
+	typedef std::shared_ptr<const SorterEventLog> LogPtr;
+
+	static constexpr size_t MAX_BYTES = 64 << 20;
+
+	// Never destroyed, like WorkerPool
+	static SorterLogCache &instance();
+
+	// Null when the log isn't cached
+	LogPtr find(t_algorithmtype type, const std::vector<int> &input);
+
+	// log must not be written anymore
+	void insert(t_algorithmtype type, const std::vector<int> &input, LogPtr log);
+
+	size_t getBytes() const
+	{
+		return bytes;
+	}
+
+	size_t getCount() const
+	{
+		return count;
+	}
+
+	size_t getHits() const
+	{
+		return hits;
+	}
+
+private:
+	struct Entry
+	{
+		uint64_t key;
+		t_algorithmtype type;
+		std::vector<int> input; // Compared on a hit, keys can collide
+		LogPtr log;
+		size_t bytes;
+	};
+
+	std::mutex mutex;
+	// Guarded by mutex, most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+	// For the diagnostics
+	std::atomic<size_t> bytes{0};
+	std::atomic<size_t> count{0};
+	std::atomic<size_t> hits{0};
+
+	SorterLogCache()
+	{
+	}
+
+	static uint64_t makeKey(t_algorithmtype type, const std::vector<int> &input);
+};
+
+#endif // _SORTER_LOG_CACHE
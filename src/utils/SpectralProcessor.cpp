@@ -0,0 +1,192 @@
+#include "SpectralProcessor.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr int SpectralProcessor::FFT_SIZE;
+constexpr int SpectralProcessor::HOP_SIZE;
+constexpr int SpectralProcessor::BINS;
+constexpr int SpectralProcessor::MAX_SHIFT;
+constexpr int SpectralProcessor::LATENCY;
+
+SpectralProcessor::SpectralProcessor()
+{
+	setup = pffft_new_setup(FFT_SIZE, PFFFT_REAL);
+	frame = (float *)pffft_aligned_malloc(FFT_SIZE * sizeof(float));
+	spectrum = (float *)pffft_aligned_malloc(FFT_SIZE * sizeof(float));
+	work = (float *)pffft_aligned_malloc(FFT_SIZE * sizeof(float));
+
+	// Periodic Hann, squared windows at 75% overlap sum to 1.5
+	window.resize(FFT_SIZE);
+	for (int i = 0; i < FFT_SIZE; ++i)
+		window[i] = 0.5f - 0.5f * std::cos(2.0f * M_PI * i / FFT_SIZE);
+
+	inputRing.resize(FFT_SIZE);
+	outputRing.resize(FFT_SIZE);
+
+	magnitude.resize(BINS);
+	phase.resize(BINS);
+	lastPhase.resize(BINS);
+	blurMagnitude.resize(BINS);
+	frozenMagnitude.resize(BINS);
+	frozenPhaseDelta.resize(BINS);
+	frozenPhase.resize(BINS);
+
+	reset();
+}
+
+SpectralProcessor::~SpectralProcessor()
+{
+	pffft_aligned_free(frame);
+	pffft_aligned_free(spectrum);
+	pffft_aligned_free(work);
+	pffft_destroy_setup(setup);
+}
+
+void SpectralProcessor::reset()
+{
+	std::fill(inputRing.begin(), inputRing.end(), 0.0f);
+	std::fill(outputRing.begin(), outputRing.end(), 0.0f);
+	std::fill(lastPhase.begin(), lastPhase.end(), 0.0f);
+	std::fill(blurMagnitude.begin(), blurMagnitude.end(), 0.0f);
+	position = 0;
+	hopCounter = 0;
+	frozen = false;
+}
+
+float SpectralProcessor::process(float in, int mode, float amount)
+{
+	inputRing[position] = in;
+	float out = outputRing[position];
+	outputRing[position] = 0.0f;
+	position = (position + 1) % FFT_SIZE;
+
+	if (++hopCounter >= HOP_SIZE)
+	{
+		hopCounter = 0;
+		processFrame(mode, std::min(std::max(amount, 0.0f), 1.0f));
+	}
+	return out;
+}
+
+void SpectralProcessor::processFrame(int mode, float amount)
+{
+	TRACE_SCOPE("SpectralProcessor::processFrame");
+
+	// position is the oldest sample in the ring
+	for (int i = 0; i < FFT_SIZE; ++i)
+		frame[i] = inputRing[(position + i) % FFT_SIZE] * window[i];
+
+	pffft_transform_ordered(setup, frame, spectrum, work, PFFFT_FORWARD);
+
+	switch (mode)
+	{
+	case SPECTRAL_MODE_FREEZE:
+		freeze(amount);
+		break;
+	case SPECTRAL_MODE_BLUR:
+		blur(amount);
+		break;
+	case SPECTRAL_MODE_SHIFT:
+		shift(amount);
+		break;
+	default:
+		break;
+	}
+
+	pffft_transform_ordered(setup, spectrum, frame, work, PFFFT_BACKWARD);
+
+	// pffft doesn't scale the inverse
+	const float norm = 1.0f / (1.5f * FFT_SIZE);
+	for (int i = 0; i < FFT_SIZE; ++i)
+		outputRing[(position + i) % FFT_SIZE] += frame[i] * window[i] * norm;
+}
+
+// The ordered pffft layout is DC, Nyquist, then re/im pairs.
+// Nyquist is dropped, DC is treated like any other bin.
+void SpectralProcessor::toPolar()
+{
+	magnitude[0] = std::fabs(spectrum[0]);
+	phase[0] = spectrum[0] < 0.0f ? M_PI : 0.0f;
+	for (int k = 1; k < BINS; ++k)
+	{
+		float re = spectrum[2 * k];
+		float im = spectrum[2 * k + 1];
+		magnitude[k] = std::sqrt(re * re + im * im);
+		phase[k] = std::atan2(im, re);
+	}
+}
+
+void SpectralProcessor::fromPolar()
+{
+	spectrum[0] = magnitude[0] * std::cos(phase[0]);
+	spectrum[1] = 0.0f;
+	for (int k = 1; k < BINS; ++k)
+	{
+		spectrum[2 * k] = magnitude[k] * std::cos(phase[k]);
+		spectrum[2 * k + 1] = magnitude[k] * std::sin(phase[k]);
+	}
+}
+
+void SpectralProcessor::freeze(float amount)
+{
+	toPolar();
+
+	bool freezing = amount > 0.5f;
+	if (freezing && !frozen)
+	{
+		// Keep every bin spinning at the frequency it had when frozen
+		for (int k = 0; k < BINS; ++k)
+		{
+			frozenMagnitude[k] = magnitude[k];
+			frozenPhaseDelta[k] = phase[k] - lastPhase[k];
+			frozenPhase[k] = phase[k];
+		}
+	}
+	frozen = freezing;
+
+	std::copy(phase.begin(), phase.end(), lastPhase.begin());
+
+	if (!frozen)
+		return;
+
+	for (int k = 0; k < BINS; ++k)
+	{
+		frozenPhase[k] = std::remainder(frozenPhase[k] + frozenPhaseDelta[k], 2.0f * (float)M_PI);
+		magnitude[k] = frozenMagnitude[k];
+		phase[k] = frozenPhase[k];
+	}
+	fromPolar();
+}
+
+void SpectralProcessor::blur(float amount)
+{
+	toPolar();
+
+	float keep = amount * 0.99f;
+	for (int k = 0; k < BINS; ++k)
+	{
+		blurMagnitude[k] = blurMagnitude[k] * keep + magnitude[k] * (1.0f - keep);
+		magnitude[k] = blurMagnitude[k];
+	}
+	fromPolar();
+}
+
+void SpectralProcessor::shift(float amount)
+{
+	int bins = (int)std::lround((amount - 0.5f) * 2.0f * MAX_SHIFT);
+	if (bins == 0)
+		return;
+
+	// Moves the complex bins 1..BINS-1, bins shifted in are silent
+	std::copy(spectrum, spectrum + FFT_SIZE, frame);
+	for (int k = 1; k < BINS; ++k)
+	{
+		int from = k - bins;
+		bool inside = from >= 1 && from < BINS;
+		spectrum[2 * k] = inside ? frame[2 * from] : 0.0f;
+		spectrum[2 * k + 1] = inside ? frame[2 * from + 1] : 0.0f;
+	}
+	spectrum[1] = 0.0f;
+}
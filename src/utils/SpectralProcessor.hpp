@@ -0,0 +1,77 @@
+#ifndef _SPECTRAL_PROCESSOR
+#define _SPECTRAL_PROCESSOR
+
+#include <vector>
+
+// From the Rack SDK, libRack exports it
+#include <pffft.h>
+
+constexpr int SPECTRAL_MODE_OFF = 0;
+constexpr int SPECTRAL_MODE_FREEZE = 1;
+constexpr int SPECTRAL_MODE_BLUR = 2;
+constexpr int SPECTRAL_MODE_SHIFT = 3;
+
+/**
+ * Streaming overlap-add STFT, Hann windowed on analysis and synthesis.
+ * Samples go in and out one at a time, every HOP_SIZE samples a frame is
+ * transformed with pffft and its spectrum edited by the mode.
+ * The output is delayed by LATENCY samples, 46 ms at 44.1 kHz.
+ *
+ * amount is in [0, 1]:
+ *  Freeze - holds the spectrum while amount is above 0.5
+ *  Blur   - how much of the previous magnitudes is kept every frame
+ *  Shift  - moves the bins up or down, 0.5 is no shift
+ */
+struct SpectralProcessor
+{
+	static constexpr int FFT_SIZE = 2048;
+	static constexpr int HOP_SIZE = FFT_SIZE / 4;
+	static constexpr int BINS = FFT_SIZE / 2;
+	static constexpr int MAX_SHIFT = BINS / 4;
+	static constexpr int LATENCY = FFT_SIZE;
+
+	PFFFT_Setup *setup = nullptr;
+
+	// pffft needs aligned buffers
+	float *frame = nullptr;
+	float *spectrum = nullptr;
+	float *work = nullptr;
+
+	std::vector<float> window;
+	std::vector<float> inputRing;
+	std::vector<float> outputRing;
+	int position = 0;
+	int hopCounter = 0;
+
+	std::vector<float> magnitude;
+	std::vector<float> phase;
+	std::vector<float> lastPhase;
+	std::vector<float> blurMagnitude;
+
+	bool frozen = false;
+	std::vector<float> frozenMagnitude;
+	std::vector<float> frozenPhaseDelta;
+	std::vector<float> frozenPhase;
+
+	SpectralProcessor();
+	~SpectralProcessor();
+
+	SpectralProcessor(const SpectralProcessor &) = delete;
+	SpectralProcessor &operator=(const SpectralProcessor &) = delete;
+
+	float process(float in, int mode, float amount);
+
+	void reset();
+
+private:
+	void processFrame(int mode, float amount);
+
+	void toPolar();
+	void fromPolar();
+
+	void freeze(float amount);
+	void blur(float amount);
+	void shift(float amount);
+};
+
+#endif // _SPECTRAL_PROCESSOR
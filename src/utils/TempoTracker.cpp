@@ -0,0 +1,61 @@
+#include "TempoTracker.hpp"
+
+#include <cmath>
+
+void TempoTracker::reset()
+{
+	period = 0.0f;
+	lag = 0.0f;
+	jumpCount = 0;
+	jumpPeriod = 0.0f;
+}
+
+bool TempoTracker::process(float interval)
+{
+	if (!(interval > 0.0f))
+		return false;
+
+	if (period <= 0.0f)
+		return relock(interval);
+
+	// Timing error of this edge against the prediction
+	float error = interval + lag - period;
+
+	if (std::fabs(interval - period) > jumpThreshold * period)
+	{
+		// Only relock when the odd intervals agree with each other
+		if (jumpCount > 0 && std::fabs(interval - jumpPeriod) > jumpThreshold * jumpPeriod)
+			jumpCount = 0;
+		jumpPeriod = interval;
+		if (++jumpCount >= jumpEdges)
+			return relock(interval);
+		// A single odd interval is a dropped or doubled edge, skip it
+		return false;
+	}
+	jumpCount = 0;
+
+	lag = (1.0f - alpha) * error;
+	period += beta * error;
+
+	if (committedPeriod <= 0.0f ||
+		std::fabs(period - committedPeriod) > hysteresis * committedPeriod)
+	{
+		committedPeriod = period;
+		return true;
+	}
+	return false;
+}
+
+bool TempoTracker::relock(float interval)
+{
+	period = interval;
+	lag = 0.0f;
+	jumpCount = 0;
+
+	if (committedPeriod > 0.0f &&
+		std::fabs(period - committedPeriod) <= hysteresis * committedPeriod)
+		return false;
+
+	committedPeriod = period;
+	return true;
+}
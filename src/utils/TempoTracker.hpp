@@ -0,0 +1,51 @@
+#ifndef _TEMPO_TRACKER
+#define _TEMPO_TRACKER
+
+/**
+ * Follows the period of an external clock with a second order loop,
+ * like a software PLL. Every edge moves the predicted edge time and the
+ * period by a fraction of the timing error, so jitter averages out.
+ *
+ * The buffer length only follows the committed period, which changes when
+ * the tracked period drifts past the hysteresis or when the clock really
+ * jumps to another tempo.
+ */
+struct TempoTracker
+{
+	// Loop gains, beta = alpha^2 / (2 - alpha) is critically damped
+	float alpha = 0.2f;
+	float beta = 0.0222f;
+
+	// Relative drift of the tracked period before it is committed
+	float hysteresis = 0.005f;
+
+	// Intervals this far off the tracked period count as a tempo jump,
+	// after jumpEdges agreeing intervals the loop relocks to them
+	float jumpThreshold = 0.2f;
+	int jumpEdges = 2;
+
+	float period = 0.0f; // Tracked period, seconds
+	float committedPeriod = 0.0f;
+
+	// Distance of the last edge from its predicted time, seconds
+	float lag = 0.0f;
+
+	int jumpCount = 0;
+	float jumpPeriod = 0.0f;
+
+	// Forgets the tracked period but keeps the committed one
+	void reset();
+
+	// Feed the time since the last edge, returns true when the committed period changed
+	bool process(float interval);
+
+	float getBPM() const
+	{
+		return period > 0.0f ? 60.0f / period : 0.0f;
+	}
+
+private:
+	bool relock(float interval);
+};
+
+#endif // _TEMPO_TRACKER
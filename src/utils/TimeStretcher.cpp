@@ -0,0 +1,115 @@
+#include "TimeStretcher.hpp"
+#include "SimdUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool TimeStretcher::stretch(const std::vector<float> &in, std::vector<float> &out,
+							size_t length, float sampleRate,
+							const volatile std::atomic<bool> *cancelled)
+{
+	const long inLength = (long)in.size();
+	out.assign(length, 0.0f);
+	if (inLength == 0 || length == 0)
+		return true;
+
+	// 40ms frames at 50% overlap, frames may move up to 10ms
+	long frameLength = std::max(16L, (long)(sampleRate * 0.04f)) & ~1L;
+	long hop = frameLength / 2;
+	long tolerance = std::max(1L, (long)(sampleRate * 0.01f));
+
+	// Too short to find whole frames in, resample instead
+	if (inLength < 2 * frameLength || (long)length < 2 * frameLength)
+	{
+		double ratio = (double)inLength / length;
+		for (size_t n = 0; n < length; ++n)
+		{
+			double pos = n * ratio;
+			long left = (long)pos;
+			float frac = (float)(pos - left);
+			out[n] = in[left % inLength] * (1.0f - frac) + in[(left + 1) % inLength] * frac;
+		}
+		return true;
+	}
+
+	// The loop unrolled around both ends so frames never need a modulo
+	long pad = frameLength + hop + 2 * tolerance;
+	std::vector<float> extended(inLength + 2 * pad);
+	for (long i = 0; i < (long)extended.size(); ++i)
+		extended[i] = in[(((i - pad) % inLength) + inLength) % inLength];
+	const float *origin = extended.data() + pad;
+
+	// Periodic Hann, sums to one at 50% overlap except where the last
+	// frame wraps onto the first, windowSum evens that out
+	std::vector<float> window(frameLength);
+	std::vector<float> windowSum(length, 0.0f);
+	for (long i = 0; i < frameLength; ++i)
+		window[i] = 0.5f - 0.5f * std::cos(2.0f * M_PI * i / frameLength);
+
+	double analysisHop = (double)hop * inLength / length;
+	long previous = 0;
+
+	for (long frame = 0; frame * hop < (long)length; ++frame)
+	{
+		if (cancelled && *cancelled)
+			return false;
+
+		long nominal = (long)std::llround(frame * analysisHop) % inLength;
+		long chosen = nominal;
+
+		if (frame > 0)
+		{
+			// Match against what would have followed the previous frame
+			const float *natural = origin + previous + hop;
+
+			auto similarity = [&](long position)
+			{
+				float ab, bb;
+				correlate(natural, origin + position, frameLength, ab, bb);
+				return ab / std::sqrt(bb + 1e-9f);
+			};
+
+			// Coarse search every 4 samples, then refine around the best
+			float best = -INFINITY;
+			for (long offset = -tolerance; offset <= tolerance; offset += 4)
+			{
+				float score = similarity(nominal + offset);
+				if (score > best)
+				{
+					best = score;
+					chosen = nominal + offset;
+				}
+			}
+			long coarse = chosen;
+			for (long offset = -3; offset <= 3; ++offset)
+			{
+				if (offset == 0)
+					continue;
+				float score = similarity(coarse + offset);
+				if (score > best)
+				{
+					best = score;
+					chosen = coarse + offset;
+				}
+			}
+		}
+
+		// Overlap-add, the tail wraps to the start of the loop
+		long outStart = frame * hop;
+		for (long i = 0; i < frameLength; ++i)
+		{
+			size_t n = (outStart + i) % length;
+			out[n] += origin[chosen + i] * window[i];
+			windowSum[n] += window[i];
+		}
+
+		previous = chosen;
+	}
+
+	for (size_t n = 0; n < length; ++n)
+	{
+		if (windowSum[n] > 1e-3f)
+			out[n] /= windowSum[n];
+	}
+	return true;
+}
@@ -0,0 +1,27 @@
+#ifndef _TIME_STRETCHER
+#define _TIME_STRETCHER
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Changes the length of a loop without changing its pitch using WSOLA
+ * (waveform similarity overlap-add). Frames are taken from the input at
+ * the stretched rate and every frame is moved, within a small tolerance,
+ * to where it best continues the previous one, found with a normalized
+ * cross correlation.
+ *
+ * Too slow for the audio thread, BufferRebuilder runs it as a WorkerPool
+ * job.
+ */
+struct TimeStretcher
+{
+	// Stretches the loop in to length samples, the loop wraps around.
+	// Returns false once cancelled is set
+	static bool stretch(const std::vector<float> &in, std::vector<float> &out,
+						size_t length, float sampleRate,
+						const volatile std::atomic<bool> *cancelled = nullptr);
+};
+
+#endif // _TIME_STRETCHER
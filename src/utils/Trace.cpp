@@ -0,0 +1,210 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+constexpr uint64_t Trace::RING_SIZE;
+constexpr int Trace::MAX_THREADS;
+std::atomic<bool> Trace::enabled{false};
+
+namespace
+{
+
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+struct Ring
+{
+	Trace::Event events[Trace::RING_SIZE];
+	// Scopes ever written, only the owning thread stores it
+	std::atomic<uint64_t> head{0};
+	// Scopes before it were written by the thread that had the ring before
+	std::atomic<uint64_t> first{0};
+	std::atomic<bool> owned{false};
+	std::atomic<const char *> name{nullptr};
+	uint32_t thread = 0;
+};
+
+struct Registry
+{
+	// Between setEnabled() and save(), recording never takes it
+	std::mutex mutex;
+	// Allocated by the first setEnabled(true), never freed
+	std::atomic<Ring *> rings[Trace::MAX_THREADS];
+	// Scopes that began earlier belong to a previous trace
+	std::atomic<uint64_t> start{0};
+
+	Registry()
+	{
+		for (std::atomic<Ring *> &ring : rings)
+			ring.store(nullptr, std::memory_order_relaxed);
+	}
+};
+
+// Never destroyed, threads may still exit after the statics are gone
+Registry &registry()
+{
+	static Registry *instance = new Registry();
+	return *instance;
+}
+
+/** Hands the thread's ring back when the thread exits */
+struct ThreadRing
+{
+	Ring *ring = nullptr;
+	const char *name = nullptr;
+
+	~ThreadRing()
+	{
+		if (ring)
+			ring->owned.store(false, std::memory_order_release);
+	}
+};
+
+thread_local ThreadRing threadRing;
+
+// Lock free, null when every ring is taken
+Ring *claimRing(const char *name)
+{
+	Registry &r = registry();
+	for (std::atomic<Ring *> &slot : r.rings)
+	{
+		Ring *ring = slot.load(std::memory_order_acquire);
+		bool owned = false;
+		if (ring && ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+		{
+			ring->first.store(ring->head.load(std::memory_order_relaxed), std::memory_order_release);
+			ring->name.store(name, std::memory_order_release);
+			return ring;
+		}
+	}
+	return nullptr;
+}
+
+} // namespace
+
+void Trace::setEnabled(bool enable)
+{
+	Registry &r = registry();
+	if (enable)
+	{
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (int i = 0; i < MAX_THREADS; ++i)
+		{
+			if (r.rings[i].load(std::memory_order_relaxed))
+				continue;
+			Ring *ring = new Ring();
+			ring->thread = (uint32_t)i;
+			r.rings[i].store(ring, std::memory_order_release);
+		}
+		r.start = now();
+	}
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t Trace::now()
+{
+	std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - processStart;
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() + 1;
+}
+
+void Trace::record(const char *name, uint64_t begin, uint64_t end)
+{
+	ThreadRing &local = threadRing;
+	if (!local.ring)
+	{
+		local.ring = claimRing(local.name);
+		if (!local.ring)
+			return;
+	}
+
+	Ring *ring = local.ring;
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	Event &event = ring->events[head & (RING_SIZE - 1)];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	event.thread = ring->thread;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const char *name)
+{
+	ThreadRing &local = threadRing;
+	// Names are compared by value, every module names the engine threads
+	if (local.name && std::strcmp(local.name, name) == 0)
+		return;
+	local.name = name;
+	if (local.ring)
+		local.ring->name.store(name, std::memory_order_release);
+}
+
+bool Trace::save(const std::string &path)
+{
+	Registry &r = registry();
+	std::vector<Event> events;
+	const char *threadNames[MAX_THREADS] = {};
+	uint64_t start = r.start;
+
+	{
+		// The threads keep recording, the lock only keeps setEnabled() out
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (int i = 0; i < MAX_THREADS; ++i)
+		{
+			Ring *ring = r.rings[i].load(std::memory_order_acquire);
+			if (!ring)
+				continue;
+			threadNames[i] = ring->name.load(std::memory_order_acquire);
+
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t first = std::max(ring->first.load(std::memory_order_acquire),
+									  head > RING_SIZE ? head - RING_SIZE : 0);
+			first = std::min(first, head);
+			size_t copied = events.size();
+			for (uint64_t n = first; n < head; ++n)
+				events.push_back(ring->events[n & (RING_SIZE - 1)]);
+
+			// The owner keeps recording, drop what it overwrote during the copy
+			uint64_t after = ring->head.load(std::memory_order_acquire);
+			uint64_t valid = after >= RING_SIZE ? after - RING_SIZE + 1 : 0;
+			if (valid > first)
+			{
+				size_t overwritten = (size_t)std::min(valid - first, head - first);
+				events.erase(events.begin() + copied, events.begin() + copied + overwritten);
+			}
+		}
+	}
+
+	events.erase(std::remove_if(events.begin(), events.end(), [=](const Event &event)
+								{ return event.begin < start; }),
+				 events.end());
+	// Parents before their children when they start together
+	std::sort(events.begin(), events.end(), [](const Event &a, const Event &b)
+			  { return a.begin != b.begin ? a.begin < b.begin : a.end > b.end; });
+
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"BGal256\"}}");
+	for (int i = 0; i < MAX_THREADS; ++i)
+	{
+		if (threadNames[i])
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+					(unsigned)i, threadNames[i]);
+	}
+	// Complete events, ts and dur are in microseconds
+	for (const Event &event : events)
+	{
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"bgal\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+				event.name, (event.begin - start) / 1000.0, (event.end - event.begin) / 1000.0, event.thread);
+	}
+	fprintf(file, "\n]}\n");
+
+	bool failed = ferror(file) != 0;
+	return fclose(file) == 0 && !failed;
+}
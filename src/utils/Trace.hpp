@@ -0,0 +1,96 @@
+#ifndef _TRACE
+#define _TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * Plugin wide recorder of timed scopes, saved as Chrome trace JSON that
+ * opens in chrome://tracing and ui.perfetto.dev.
+ *
+ * Every thread writes its scopes to its own ring, only the owning thread
+ * writes and save() reads, so recording takes no lock. The rings are
+ * allocated by the first setEnabled(true) and kept, a thread claims a free
+ * one with its first scope and hands it back when it exits. The ring is
+ * the thread's track, a thread that takes over a ring drops the scopes of
+ * the one before. Full rings drop their oldest scopes, threads past
+ * MAX_THREADS aren't recorded.
+ *
+ * While disabled a scope costs one relaxed load, defining BGAL_NO_TRACE
+ * removes the scopes from the build.
+ */
+struct Trace
+{
+	// Scopes kept per thread, a power of two
+	static constexpr uint64_t RING_SIZE = 1 << 15;
+	// Threads recorded at once, a ring is 1MB
+	static constexpr int MAX_THREADS = 16;
+
+	struct Event
+	{
+		const char *name; // Must outlive the trace, use literals
+		uint64_t begin;	  // ns since the process started
+		uint64_t end;
+		uint32_t thread;
+	};
+
+	/** Records from construction to destruction when the trace is enabled */
+	struct Scope
+	{
+		const char *name;
+		uint64_t begin;
+
+		Scope(const char *name) : name(name)
+		{
+			begin = Trace::isEnabled() ? Trace::now() : 0;
+		}
+
+		~Scope()
+		{
+			// A scope started before the trace was enabled is dropped
+			if (begin)
+				Trace::record(name, begin, Trace::now());
+		}
+	};
+
+	static bool isEnabled()
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	// Enabling starts a new trace, the previous scopes aren't saved. Not
+	// from the audio thread, the first call allocates the rings
+	static void setEnabled(bool enable);
+
+	// Never 0, so 0 can mean "not recording"
+	static uint64_t now();
+
+	static void record(const char *name, uint64_t begin, uint64_t end);
+
+	// Shown as the thread's track, name must outlive the trace
+	static void setThreadName(const char *name);
+
+	// Writes the scopes recorded since the trace was enabled
+	static bool save(const std::string &path);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+#ifdef BGAL_NO_TRACE
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD(name)
+#else
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD(name)             \
+	do                                 \
+	{                                  \
+		if (Trace::isEnabled())        \
+			Trace::setThreadName(name); \
+	} while (0)
+#endif
+
+#endif
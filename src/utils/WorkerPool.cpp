@@ -0,0 +1,309 @@
+#include "WorkerPool.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+constexpr int WorkerPool::MAX_WORKERS;
+constexpr int WorkerPool::MAX_STAND_INS;
+constexpr size_t WorkerPool::QUEUE_SIZE;
+
+// Set on the pool's threads, for beginBlocking()
+static thread_local bool onWorker = false;
+
+// Below the engine threads, the scheduler still runs the workers when
+// the engine spins
+static void lowerPriority()
+{
+#if defined(_WIN32)
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__APPLE__)
+	pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+	// Linux applies the nice value per thread
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+}
+
+static void pinToCore(int core)
+{
+#if defined(_WIN32)
+	DWORD_PTR mask = core < 0 ? ~(DWORD_PTR)0 : (DWORD_PTR)1 << core;
+	DWORD_PTR processMask, systemMask;
+	if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		mask &= processMask;
+	if (mask)
+		SetThreadAffinityMask(GetCurrentThread(), mask);
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	int cores = WorkerPool::getCoreCount();
+	for (int i = 0; i < cores; ++i)
+	{
+		if (core < 0 || i == core)
+			CPU_SET(i, &set);
+	}
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)core;
+#endif
+}
+
+// Never destroyed, joining threads from a static destructor can deadlock
+// on plugin unload
+WorkerPool &WorkerPool::instance()
+{
+	static WorkerPool *pool = new WorkerPool();
+	return *pool;
+}
+
+WorkerPool::WorkerPool()
+{
+	for (size_t i = 0; i < QUEUE_SIZE; ++i)
+	{
+		queue[i].sequence.store(i, std::memory_order_relaxed);
+		queue[i].job = nullptr;
+	}
+
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&jobAdded, NULL);
+	pthread_cond_init(&jobFinished, NULL);
+
+	// Half the cores at most, the rest are for the engine and the UI
+	int count = std::max(1, std::min(MAX_WORKERS, getCoreCount() / 2));
+	pthread_mutex_lock(&mutex);
+	for (int i = 0; i < count; ++i)
+		startThread();
+	workerCount = threads;
+	pthread_mutex_unlock(&mutex);
+}
+
+bool WorkerPool::submit(Job &job)
+{
+	job.cancelled = false;
+	job.failed = false;
+	job.finished = false;
+
+	// Never run on the caller, that may be the audio thread
+	if (workerCount == 0 || !push(&job))
+	{
+		job.failed = true;
+		job.finished = true;
+		return false;
+	}
+
+	// Pairs with the fence in processInThread(), either a worker going idle
+	// sees the job or this sees the worker
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (idle.load(std::memory_order_relaxed) > 0)
+	{
+		// A held mutex may be a worker about to wait, its timeout covers that
+		bool locked = pthread_mutex_trylock(&mutex) == 0;
+		pthread_cond_signal(&jobAdded);
+		if (locked)
+			pthread_mutex_unlock(&mutex);
+	}
+	return true;
+}
+
+void WorkerPool::wait(const Job &job)
+{
+	if (job.finished)
+		return;
+
+	pthread_mutex_lock(&mutex);
+	while (!job.finished)
+		pthread_cond_wait(&jobFinished, &mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+void WorkerPool::beginBlocking()
+{
+	if (!onWorker)
+		return;
+
+	WorkerPool &pool = instance();
+	pthread_mutex_lock(&pool.mutex);
+	++pool.blocked;
+	if (pool.threads - pool.blocked < pool.workerCount && pool.threads < pool.workerCount + MAX_STAND_INS)
+		pool.startThread();
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+void WorkerPool::endBlocking()
+{
+	if (!onWorker)
+		return;
+
+	WorkerPool &pool = instance();
+	pthread_mutex_lock(&pool.mutex);
+	--pool.blocked;
+	// The worker that stood in leaves when it next runs out of jobs
+	pthread_cond_signal(&pool.jobAdded);
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+void WorkerPool::setAffinity(int core)
+{
+	affinity = core < getCoreCount() ? core : -1;
+}
+
+int WorkerPool::getAffinity() const
+{
+	return affinity;
+}
+
+bool WorkerPool::isAffinitySupported()
+{
+#if defined(_WIN32) || defined(__linux__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+int WorkerPool::getCoreCount()
+{
+	return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+// Vyukov's bounded queue, every slot's sequence tells whether it is the
+// next to push or to pop at position
+bool WorkerPool::push(Job *job)
+{
+	size_t position = pushPosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot &slot = queue[position & (QUEUE_SIZE - 1)];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+		if (difference == 0)
+		{
+			if (pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				slot.job = job;
+				slot.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+			return false; // Full
+		else
+			position = pushPosition.load(std::memory_order_relaxed);
+	}
+}
+
+WorkerPool::Job *WorkerPool::pop()
+{
+	size_t position = popPosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot &slot = queue[position & (QUEUE_SIZE - 1)];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+		if (difference == 0)
+		{
+			if (popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				Job *job = slot.job;
+				slot.sequence.store(position + QUEUE_SIZE, std::memory_order_release);
+				return job;
+			}
+		}
+		else if (difference < 0)
+			return nullptr; // Empty
+		else
+			position = popPosition.load(std::memory_order_relaxed);
+	}
+}
+
+// With mutex held
+void WorkerPool::startThread()
+{
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_t thread;
+	if (pthread_create(&thread, &attr, &WorkerPool::threadFunction, this) == 0)
+		++threads;
+	pthread_attr_destroy(&attr);
+}
+
+void *WorkerPool::threadFunction(void *arg)
+{
+	WorkerPool *instance = static_cast<WorkerPool *>(arg);
+	instance->processInThread();
+	return NULL;
+}
+
+void WorkerPool::processInThread()
+{
+	lowerPriority();
+	onWorker = true;
+	int pinned = -1;
+
+	while (true)
+	{
+		Job *job = pop();
+		if (!job)
+		{
+			pthread_mutex_lock(&mutex);
+			// One more than needed since a blocked job returned
+			if (threads - blocked > workerCount)
+			{
+				--threads;
+				pthread_mutex_unlock(&mutex);
+				return;
+			}
+
+			++idle;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			job = pop();
+			if (!job)
+			{
+				// submit() may signal just before the wait, don't sleep through it
+				std::chrono::system_clock::time_point wake =
+					std::chrono::system_clock::now() + std::chrono::milliseconds(100);
+				std::chrono::nanoseconds since = wake.time_since_epoch();
+				timespec deadline;
+				deadline.tv_sec = (time_t)std::chrono::duration_cast<std::chrono::seconds>(since).count();
+				deadline.tv_nsec = (long)(since.count() % 1000000000);
+				pthread_cond_timedwait(&jobAdded, &mutex, &deadline);
+			}
+			--idle;
+			pthread_mutex_unlock(&mutex);
+			if (!job)
+				continue;
+		}
+
+		if (affinity != pinned)
+		{
+			pinned = affinity;
+			pinToCore(pinned);
+		}
+
+		{
+			TRACE_THREAD("WorkerPool");
+			job->run(*job);
+		}
+
+		// The owner may submit the job again as soon as it sees it finished
+		pthread_mutex_lock(&mutex);
+		job->finished = true;
+		pthread_cond_broadcast(&jobFinished);
+		pthread_mutex_unlock(&mutex);
+	}
+}
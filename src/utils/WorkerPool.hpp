@@ -0,0 +1,117 @@
+#ifndef _WORKER_POOL
+#define _WORKER_POOL
+
+#include <atomic>
+#include <cstddef>
+#include <pthread.h>
+
+/**
+ * Plugin wide pool of background workers for jobs that would otherwise
+ * each start a thread, like the SortStep calculations. A burst of jobs
+ * queues up behind a few workers instead of starting a thread per module
+ * next to Rack's engine threads.
+ *
+ * Jobs belong to whoever submits them and are queued by pointer on a
+ * fixed size lock free queue, so submit() neither allocates nor locks and
+ * can be called from the audio thread. A job is submitted again once it
+ * has finished.
+ *
+ * A job that waits on something other than the pool, like a streamed
+ * sort waiting for its reader, calls beginBlocking() and another worker
+ * takes its place until endBlocking(). A few waiting jobs then can't keep
+ * the others queued. At most MAX_STAND_INS threads are started for them,
+ * past that a blocked job keeps its worker.
+ *
+ * Workers run below normal priority and can be pinned to one core. Every
+ * job has its own cancel flag, a cancelled job still runs and is expected
+ * to return early.
+ */
+struct WorkerPool
+{
+	struct Job
+	{
+		// Called on a worker, context is for run to use
+		void (*run)(Job &job) = nullptr;
+		void *context = nullptr;
+		// Polled by the job, the type SorterAlgorithm::externalStopFlag takes
+		volatile std::atomic<bool> cancelled{false};
+		std::atomic<bool> finished{true};
+		// Never ran, the pool had no worker or no room for it
+		std::atomic<bool> failed{false};
+
+		void cancel()
+		{
+			cancelled = true;
+		}
+	};
+
+	static constexpr int MAX_WORKERS = 4;
+	static constexpr int MAX_STAND_INS = MAX_WORKERS;
+	// Jobs waiting for a worker, a power of two
+	static constexpr size_t QUEUE_SIZE = 256;
+
+	// Started by the first call
+	static WorkerPool &instance();
+
+	// job must be finished. Lock and allocation free, returns false and
+	// finishes the job as failed when it can't be queued
+	bool submit(Job &job);
+
+	// Blocks until the job has finished, never from the audio thread
+	void wait(const Job &job);
+
+	// From inside a job, a no-op off the workers
+	static void beginBlocking();
+	static void endBlocking();
+
+	// Core the workers are pinned to from their next job, -1 for any
+	void setAffinity(int core);
+	int getAffinity() const;
+	static bool isAffinitySupported();
+	static int getCoreCount();
+
+	int getWorkerCount() const
+	{
+		return workerCount;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		Job *job;
+	};
+
+	// Bounded multi producer multi consumer queue, see push() and pop()
+	Slot queue[QUEUE_SIZE];
+	std::atomic<size_t> pushPosition{0};
+	std::atomic<size_t> popPosition{0};
+
+	pthread_mutex_t mutex;
+	pthread_cond_t jobAdded;
+	pthread_cond_t jobFinished;
+
+	// Workers that aren't blocked, without the ones started for blocked jobs
+	int workerCount = 0;
+	// Guarded by mutex
+	int threads = 0;
+	int blocked = 0;
+	// Workers waiting on jobAdded
+	std::atomic<int> idle{0};
+
+	std::atomic<int> affinity{-1};
+
+	WorkerPool();
+
+	bool push(Job *job);
+
+	Job *pop();
+
+	void startThread();
+
+	static void *threadFunction(void *arg);
+
+	void processInThread();
+};
+
+#endif // _WORKER_POOL
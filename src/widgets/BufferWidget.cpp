@@ -1,6 +1,7 @@
 #include "BufferWidget.hpp"
 
 #include "../BufferSludger.hpp"
+#include "utils/Trace.hpp"
 
 BufferDisplayWidget::BufferDisplayWidget()
 {
@@ -25,6 +26,9 @@ void BufferDisplayWidget::draw(const DrawArgs &args)
 
 void BufferDisplayWidget::drawScene(const DrawArgs &args)
 {
+    TRACE_THREAD("UI");
+    TRACE_SCOPE("BufferDisplayWidget::drawScene");
+
     auto &vg = args.vg;
 
     NVGcolor bgColor = nvgRGBA(0x38, 0x55, 0x74, 0xFF);
@@ -70,11 +74,22 @@ void BufferDisplayWidget::drawScene(const DrawArgs &args)
             sampleCount = this->module->samples[0].size();
         }
 
-        snprintf(
-            infoText,
-            sizeof(infoText),
-            "samples: %d (%.3f sec)",
-            (int)sampleCount, duration);
+        if (this->module && this->module->exporter.isRunning())
+        {
+            snprintf(
+                infoText,
+                sizeof(infoText),
+                "exporting: %d%%",
+                (int)(this->module->exporter.progress * 100));
+        }
+        else
+        {
+            snprintf(
+                infoText,
+                sizeof(infoText),
+                "samples: %d (%.3f sec)",
+                (int)sampleCount, duration);
+        }
 
         nvgFontSize(vg, 12.0f);
         nvgFontFaceId(vg, font->handle);
@@ -87,9 +102,23 @@ void BufferDisplayWidget::drawScene(const DrawArgs &args)
             infoText,
             nullptr);
     }
+
+    // Export progress bar along the bottom edge
+    if (this->module && this->module->exporter.isRunning())
+    {
+        Rect bar = getBox();
+        bar.pos.y = bar.getBottom() - 3;
+        bar.size.y = 3;
+        bar.size.x *= this->module->exporter.progress;
+
+        nvgBeginPath(vg);
+        nvgRect(vg, bar.pos.x, bar.pos.y, bar.size.x, bar.size.y);
+        nvgFillColor(vg, nvgRGB(255, 255, 255));
+        nvgFill(vg);
+    }
 }
 
-void BufferDisplayWidget::drawDisk(const DrawArgs &args, Rect box, const std::vector<float> &samples)
+void BufferDisplayWidget::drawDisk(const DrawArgs &args, Rect box, const SampleBuffer &samples)
 {
     float radius = std::min(box.size.x, box.size.y) / 2.0f;
 
@@ -217,7 +246,7 @@ void BufferDisplayWidget::drawDisk(const DrawArgs &args, Rect box, const std::ve
     }
 }
 
-void BufferDisplayWidget::drawSamples(const DrawArgs &args, Rect box, const std::vector<float> &samples)
+void BufferDisplayWidget::drawSamples(const DrawArgs &args, Rect box, const SampleBuffer &samples)
 {
     if (samples.empty())
         return;
@@ -1,5 +1,6 @@
 #pragma once
 #include "plugin.hpp"
+#include "utils/SampleBuffer.hpp"
 
 #include <vector>
 
@@ -25,9 +26,9 @@ struct BufferDisplayWidget : Widget  {
 
     void drawScene(const DrawArgs& args);
 
-    void drawSamples(const DrawArgs& args, Rect box, const std::vector<float>& samples);
+    void drawSamples(const DrawArgs& args, Rect box, const SampleBuffer& samples);
 
-    void drawDisk(const DrawArgs& args, Rect box, const std::vector<float>& samples);
+    void drawDisk(const DrawArgs& args, Rect box, const SampleBuffer& samples);
 
     void drawBar(
         const DrawArgs& args, 
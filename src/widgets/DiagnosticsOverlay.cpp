@@ -0,0 +1,78 @@
+#include "DiagnosticsOverlay.hpp"
+
+constexpr int DiagnosticsOverlay::REFRESH_FRAMES;
+
+DiagnosticsOverlay::DiagnosticsOverlay()
+{
+    visible = false;
+}
+
+void DiagnosticsOverlay::step()
+{
+    Widget::step();
+
+    if (!visible)
+        return;
+    if (--framesToRefresh > 0)
+        return;
+    framesToRefresh = REFRESH_FRAMES;
+
+    lines.clear();
+    if (collect)
+        collect(lines);
+}
+
+void DiagnosticsOverlay::drawLayer(const DrawArgs &args, int layer)
+{
+    // Layer 1 stays readable with the room lights dimmed
+    if (layer != 1 || lines.empty())
+        return;
+
+    std::shared_ptr<window::Font> font = APP->window->loadFont(
+        asset::system("res/fonts/ShareTechMono-Regular.ttf"));
+    if (!font || font->handle < 0)
+        return;
+
+    const float fontSize = 10.0f;
+    const float lineHeight = 12.0f;
+    const float padding = 4.0f;
+
+    NVGcontext *vg = args.vg;
+    nvgFontFaceId(vg, font->handle);
+    nvgFontSize(vg, fontSize);
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+
+    float width = 0.0f;
+    for (const std::string &line : lines)
+        width = std::max(width, nvgTextBounds(vg, 0, 0, line.c_str(), NULL, NULL));
+
+    nvgBeginPath(vg);
+    nvgRoundedRect(vg, 0, 0,
+                   std::min(width + 2 * padding, box.size.x),
+                   std::min(lines.size() * lineHeight + 2 * padding, box.size.y), 3.0f);
+    nvgFillColor(vg, nvgRGBA(0x10, 0x10, 0x10, 0xD8));
+    nvgFill(vg);
+
+    nvgFillColor(vg, nvgRGBA(0x9C, 0xF0, 0x9C, 0xFF));
+    for (size_t i = 0; i < lines.size(); ++i)
+        nvgText(vg, padding, padding + i * lineHeight, lines[i].c_str(), NULL);
+}
+
+std::string DiagnosticsOverlay::formatBytes(size_t bytes)
+{
+    if (bytes >= (1 << 20))
+        return string::f("%.1f MB", bytes / (1024.0 * 1024.0));
+    if (bytes >= (1 << 10))
+        return string::f("%.1f KB", bytes / 1024.0);
+    return string::f("%d B", (int)bytes);
+}
+
+void appendDiagnosticsMenu(Menu *menu, DiagnosticsOverlay *overlay)
+{
+    if (!overlay)
+        return;
+
+    menu->addChild(createCheckMenuItem("Show Diagnostics", "", [=]()
+                                       { return overlay->visible; }, [=]()
+                                       { overlay->visible ^= true; }));
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "plugin.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Live internal metrics drawn over a module's panel, hidden until
+ * "Show Diagnostics" is checked in the context menu.
+ *
+ * collect fills one line per metric. It runs on the UI thread a few
+ * times a second while the overlay is visible.
+ */
+struct DiagnosticsOverlay : Widget
+{
+    static constexpr int REFRESH_FRAMES = 15;
+
+    std::function<void(std::vector<std::string> &)> collect;
+
+    DiagnosticsOverlay();
+
+    void step() override;
+
+    void drawLayer(const DrawArgs &args, int layer) override;
+
+    static std::string formatBytes(size_t bytes);
+
+private:
+    std::vector<std::string> lines;
+    int framesToRefresh = 0;
+};
+
+void appendDiagnosticsMenu(Menu *menu, DiagnosticsOverlay *overlay);
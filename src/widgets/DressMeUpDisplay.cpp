@@ -4,9 +4,11 @@
 #include <context.hpp>
 
 #include "Utils.hpp"
+#include "Trace.hpp"
 
 #include "stb_image_wrapper.h"
 
+#include <chrono>
 #include <unordered_map>
 
 // Helper to convert OpenGL error codes to readable strings
@@ -266,6 +268,7 @@ void DressMeUpGLWidget::createMainBuffer(const math::Vec &size)
     }
 
     this->fb = nvgluCreateFramebuffer(APP->window->vg, size.x, size.y, 0);
+    this->mainBufferSize = size;
 
     // Delete NanoVG's default stencil buffer (we'll replace it)
     glDeleteRenderbuffers(1, &fb->rbo);
@@ -335,6 +338,9 @@ void DressMeUpGLWidget::step()
 
 void DressMeUpGLWidget::drawFramebuffer()
 {
+    TRACE_THREAD("UI");
+    TRACE_SCOPE("DressMeUpGLWidget::drawFramebuffer");
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
 
     math::Vec renderSize = getFramebufferSize();
     float zoom = APP->scene->rackScroll->getZoom();
@@ -369,10 +375,34 @@ void DressMeUpGLWidget::drawFramebuffer()
 
         // saveNVGImageToFile(APP->window->vg, fb->image, "D:\\Projects\\VisualCode\\VCVRackTest\\asdasd.png");
     }
+
+    // CPU time to submit the frame, the driver may still be drawing it
+    lastFrameMs = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - frameStart).count();
+}
+
+size_t DressMeUpGLWidget::videoMemoryBytes()
+{
+    size_t bytes = 0;
+    for (const t_img_ptr &texture : textures)
+    {
+        if (texture && texture->textureID)
+            bytes += (size_t)texture->imageWidth * texture->imageHeight * 4;
+    }
+
+    // RGBA8 color and a 24/8 depth-stencil buffer for both framebuffers
+    if (fb)
+        bytes += (size_t)mainBufferSize.x * mainBufferSize.y * 8;
+    math::Vec cacheSize = getFramebufferSize();
+    bytes += (size_t)cacheSize.x * cacheSize.y * 8;
+    return bytes;
 }
 
 void DressMeUpGLWidget::draw(const DrawArgs &args)
 {
+    TRACE_THREAD("UI");
+    TRACE_SCOPE("DressMeUpGLWidget::draw");
+
     DressMeUpBase::draw(args);
 
     if (!this->module)
@@ -822,6 +852,8 @@ static bool isOpenGL33OrAbove()
 
 void DressMeUpDisplay::drawLayer(const DrawArgs &args, int layer)
 {
+    TRACE_SCOPE("DressMeUpDisplay::drawLayer");
+
     // Menu Demo
     if (!child || !child->module)
     {
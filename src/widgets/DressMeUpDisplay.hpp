@@ -86,9 +86,13 @@ struct DressMeUpGLWidget : DressMeUpBase
     NVGLUframebuffer *fb = nullptr;
     GLuint depthRB = 0;
     GLuint filterProgram = 0;
+    math::Vec mainBufferSize;
 
     bool initialized = false;
 
+    // For the diagnostics overlay
+    float lastFrameMs = 0.0f;
+
     float vertices[10] = {
         0.0f, 0.0f, // Center
         1.0f, 0.0f, // Bottom-left
@@ -150,13 +154,10 @@ struct DressMeUpGLWidget : DressMeUpBase
     void generateSampleTexture();
 
     void onContextDestroy(const ContextDestroyEvent &e) override;
-};
 
-static float rangeMap(float x, float a, float b, float A, float B)
-{
-    if (b == a) return A;
-    return (x - a) / (b - a) * (B - A) + A;
-}
+    // Estimate of the textures and framebuffers, drivers may pad them
+    size_t videoMemoryBytes();
+};
 
 struct DressMeUpDisplay : Widget
 {
@@ -667,11 +667,15 @@ void SorterArrayWidget::draw(const DrawArgs &args)
             drawRect(args, i, defaultColor);
         }
 
-        if (sorterArray->eventCurrent)
+        // A copy, the audio thread keeps playing while this draws
+        SorterArrayEvent event;
+        if (sorterArray->getDisplayEvent(event))
         {
-            auto &elements = sorterArray->eventCurrent->elements;
-            for (SelectedType &st : elements)
+            SelectedType elements[2];
+            int elementCount = event.getElements(elements);
+            for (int e = 0; e < elementCount; ++e)
             {
+                const SelectedType &st = elements[e];
                 NVGcolor color = defaultColor;
                 switch (st.elementEvent)
                 {
@@ -744,7 +748,7 @@ void SorterArrayWidget::draw(const DrawArgs &args)
         {
             string = "Array's Empty!";
         }
-        else if (!sorterArray->processingFinished)
+        else if (!sorterArray->processingFinished && sorterArray->section != SECTION_STEP)
         {
             string = "Calculating...";
         }
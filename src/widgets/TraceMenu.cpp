@@ -0,0 +1,42 @@
+#include "TraceMenu.hpp"
+
+#include "utils/Trace.hpp"
+
+#include <osdialog.h>
+
+struct TraceSaveItem : MenuItem
+{
+    void onAction(const event::Action &e) override
+    {
+        static const char FILE_FILTERS[] = "Chrome Trace (.json):json,JSON";
+
+        osdialog_filters *filters = osdialog_filters_parse(FILE_FILTERS);
+        DEFER({ osdialog_filters_free(filters); });
+
+        char *pathC = osdialog_file(OSDIALOG_SAVE, NULL, "bgal-trace.json", filters);
+        if (!pathC)
+        {
+            return;
+        }
+
+        std::string path(pathC);
+        std::free(pathC);
+
+        if (system::getExtension(path) != ".json")
+            path += ".json";
+
+        if (!Trace::save(path))
+            WARN("Could not write trace to %s", path.c_str());
+    }
+};
+
+void appendTraceMenu(Menu *menu)
+{
+    menu->addChild(new MenuSeparator());
+
+    menu->addChild(createCheckMenuItem("Record Trace", "", []()
+                                       { return Trace::isEnabled(); }, []()
+                                       { Trace::setEnabled(!Trace::isEnabled()); }));
+
+    menu->addChild(createMenuItem<TraceSaveItem>("Save Trace..."));
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include "plugin.hpp"
+
+// "Record Trace" and "Save Trace..." for every module's context menu
+void appendTraceMenu(Menu *menu);
@@ -0,0 +1,346 @@
+/**
+ * Times the SampleInterpolation kernels and the output filters.
+ *
+ * Every kernel reads from a std::vector<float> (scalar fetch), a float
+ * SampleBuffer and a compact SampleBuffer (both fetch through SimdUtils)
+ * for buffers from L1 sized to larger than the last level cache, moving
+ * forward, in reverse and jumping to a random position every sample.
+ * `make interp-bench` also builds interp-bench-scalar with
+ * SIMD_UTILS_SCALAR defined, compare the two for the SIMD paths.
+ *
+ * Cache misses come from perf_event_open on Linux and read n/a when the
+ * counters aren't available (other systems, containers, a strict
+ * perf_event_paranoid).
+ */
+
+#include "MathUtils.hpp"
+#include "SampleBuffer.hpp"
+#include "SimdUtils.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** Hardware cache miss counter for the calling thread */
+struct CacheMissCounter
+{
+	int fd = -1;
+
+	CacheMissCounter()
+	{
+#ifdef __linux__
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+
+	bool available() const
+	{
+		return fd >= 0;
+	}
+
+	void start()
+	{
+#ifdef __linux__
+		if (fd < 0)
+			return;
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	uint64_t stop()
+	{
+		uint64_t count = 0;
+#ifdef __linux__
+		if (fd < 0)
+			return 0;
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fd, &count, sizeof(count)) != sizeof(count))
+			count = 0;
+#endif
+		return count;
+	}
+};
+
+enum Pattern
+{
+	PATTERN_FORWARD,
+	PATTERN_REVERSE,
+	PATTERN_RANDOM,
+	PATTERNS_LEN
+};
+
+static const char *PATTERN_NAMES[PATTERNS_LEN] = {"forward", "reverse", "random"};
+
+// Not a multiple of the sample rate, every read has a fraction
+static const double SPEED = 1.37;
+
+/**
+ * Read positions in the order a pattern visits them. Advances like the
+ * module's 32.32 fixed point position, the random pattern uses xorshift
+ * so the generator costs about as much as a step.
+ */
+struct Walker
+{
+	Pattern pattern;
+	uint64_t size;
+	uint64_t value = 0;
+	uint64_t step;
+	uint32_t state = 2463534242u;
+
+	Walker(Pattern pattern, size_t size) : pattern(pattern), size(size)
+	{
+		step = (uint64_t)(SPEED * 4294967296.0);
+	}
+
+	void next(long &i0, float &t)
+	{
+		uint64_t wrap = size << 32;
+		switch (pattern)
+		{
+		case PATTERN_FORWARD:
+			value += step;
+			if (value >= wrap)
+				value -= wrap;
+			break;
+		case PATTERN_REVERSE:
+			value = value >= step ? value - step : value + wrap - step;
+			break;
+		default:
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			value = ((uint64_t)(state % size) << 32) | (state & 0xffffffffu);
+			break;
+		}
+		i0 = (long)(value >> 32);
+		t = (float)(value & 0xffffffffu) * (1.0f / 4294967296.0f);
+	}
+};
+
+struct Result
+{
+	double nsPerSample;
+	double missesPerSample; // Negative without counters
+	float sink; // Keeps the reads alive
+};
+
+template <typename T, typename Kernel>
+static Result run(const T &samples, Pattern pattern, size_t reads, Kernel kernel, CacheMissCounter &counter)
+{
+	Result result;
+	float sum = 0.0f;
+
+	// Warm up the caches and the branch predictor like a running module
+	Walker warm(pattern, samples.size());
+	for (size_t n = 0; n < reads / 8; ++n)
+	{
+		long i0;
+		float t;
+		warm.next(i0, t);
+		sum += kernel(samples, i0, t);
+	}
+
+	Walker walker(pattern, samples.size());
+	counter.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t n = 0; n < reads; ++n)
+	{
+		long i0;
+		float t;
+		walker.next(i0, t);
+		sum += kernel(samples, i0, t);
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t misses = counter.stop();
+
+	result.nsPerSample = elapsed * 1e9 / reads;
+	result.missesPerSample = counter.available() ? (double)misses / reads : -1.0;
+	result.sink = sum;
+	return result;
+}
+
+#define BENCH_KERNEL(KERNEL) \
+	struct Kernel_##KERNEL \
+	{ \
+		template <typename T> \
+		float operator()(const T &samples, long i0, float t) const \
+		{ \
+			return SampleInterpolation::KERNEL(samples, i0, t); \
+		} \
+	};
+
+BENCH_KERNEL(none)
+BENCH_KERNEL(linear)
+BENCH_KERNEL(cubic)
+BENCH_KERNEL(optimal2X)
+BENCH_KERNEL(optimal8X)
+BENCH_KERNEL(optimal32X)
+
+#undef BENCH_KERNEL
+
+static float sinkTotal = 0.0f;
+
+static void printResult(const char *name, const char *storage, size_t bytes, const char *pattern, const Result &result)
+{
+	char size[32];
+	if (bytes >= (1 << 20))
+		snprintf(size, sizeof(size), "%zuMB", bytes >> 20);
+	else
+		snprintf(size, sizeof(size), "%zuKB", bytes >> 10);
+
+	if (result.missesPerSample >= 0.0)
+		printf("%-12s %-8s %7s %-8s %8.2f %10.4f\n", name, storage, size, pattern, result.nsPerSample, result.missesPerSample);
+	else
+		printf("%-12s %-8s %7s %-8s %8.2f %10s\n", name, storage, size, pattern, result.nsPerSample, "n/a");
+	sinkTotal += result.sink;
+}
+
+template <typename Kernel>
+static void benchKernel(const char *name, Kernel kernel,
+	const std::vector<float> &vector, const SampleBuffer &buffer, const SampleBuffer &compact,
+	size_t reads, CacheMissCounter &counter)
+{
+	for (int p = 0; p < PATTERNS_LEN; ++p)
+	{
+		Pattern pattern = (Pattern)p;
+		printResult(name, "vector", vector.size() * sizeof(float), PATTERN_NAMES[p],
+			run(vector, pattern, reads, kernel, counter));
+		printResult(name, "float", buffer.size() * sizeof(float), PATTERN_NAMES[p],
+			run(buffer, pattern, reads, kernel, counter));
+		printResult(name, "compact", compact.size() * sizeof(int16_t), PATTERN_NAMES[p],
+			run(compact, pattern, reads, kernel, counter));
+	}
+}
+
+template <typename Filter>
+static void benchFilter(const char *name, Filter &filter, size_t reads, CacheMissCounter &counter)
+{
+	// Small enough to stay in L1, only the recursion is measured
+	std::vector<float> in(4096);
+	for (size_t i = 0; i < in.size(); ++i)
+		in[i] = std::sin(i * 0.05f);
+
+	float sum = 0.0f;
+	counter.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t n = 0; n < reads; ++n)
+		sum += filter.process(in[n & 4095]);
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t misses = counter.stop();
+
+	Result result;
+	result.nsPerSample = elapsed * 1e9 / reads;
+	result.missesPerSample = counter.available() ? (double)misses / reads : -1.0;
+	result.sink = sum;
+	printResult(name, "-", in.size() * sizeof(float), "forward", result);
+}
+
+int main(int argc, char **argv)
+{
+	size_t reads = 1 << 22;
+	size_t maxBytes = (size_t)64 << 20;
+	std::string only;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--reads" && i + 1 < argc)
+			reads = strtoul(argv[++i], NULL, 10);
+		else if (arg == "--max-mb" && i + 1 < argc)
+			maxBytes = strtoul(argv[++i], NULL, 10) << 20;
+		else if (arg == "--kernel" && i + 1 < argc)
+			only = argv[++i];
+		else
+		{
+			fprintf(stderr,
+				"usage: interp-bench [--reads N] [--max-mb N] [--kernel NAME]\n"
+				"  --reads N      samples read per measurement, default 4194304\n"
+				"  --max-mb N     largest float buffer in MB, default 64\n"
+				"  --kernel NAME  only this kernel or filter\n");
+			return 1;
+		}
+	}
+
+	CacheMissCounter counter;
+#if defined(SIMD_UTILS_SSE2)
+	const char *simd = "SSE2";
+#elif defined(SIMD_UTILS_NEON)
+	const char *simd = "NEON";
+#else
+	const char *simd = "scalar";
+#endif
+	printf("SimdUtils: %s, cache miss counters: %s\n", simd, counter.available() ? "yes" : "n/a");
+	printf("%-12s %-8s %7s %-8s %8s %10s\n", "kernel", "storage", "size", "pattern", "ns/smp", "miss/smp");
+
+	// 16KB fits L1, 256KB L2, 4MB a typical LLC slice, 64MB none of them
+	for (size_t bytes = (size_t)16 << 10; bytes <= maxBytes; bytes *= 16)
+	{
+		size_t size = bytes / sizeof(float);
+		std::vector<float> vector(size);
+		for (size_t i = 0; i < size; ++i)
+			vector[i] = std::sin(i * 0.01f) * 5.0f;
+
+		SampleBuffer buffer;
+		buffer.assign(std::vector<float>(vector));
+		SampleBuffer compact;
+		compact.setCompact(true);
+		compact.assign(std::vector<float>(vector));
+
+#define BENCH(KERNEL) \
+		if (only.empty() || only == #KERNEL) \
+			benchKernel(#KERNEL, Kernel_##KERNEL(), vector, buffer, compact, reads, counter);
+
+		BENCH(none)
+		BENCH(linear)
+		BENCH(cubic)
+		BENCH(optimal2X)
+		BENCH(optimal8X)
+		BENCH(optimal32X)
+
+#undef BENCH
+	}
+
+	if (only.empty() || only == "LowPassFilter")
+	{
+		LowPassFilter lowPass;
+		lowPass.setCoefficients(44100.0f, 20000.0f);
+		benchFilter("LowPassFilter", lowPass, reads, counter);
+	}
+	if (only.empty() || only == "HPFilter")
+	{
+		HPFilter highPass(44100.0f, 20.0f);
+		benchFilter("HPFilter", highPass, reads, counter);
+	}
+
+	// Printed so the compiler can't drop the reads
+	fprintf(stderr, "checksum %g\n", sinkTotal);
+	return 0;
+}
@@ -0,0 +1,422 @@
+/**
+ * Runs every module's process() without Rack, on scripted CV, and reports
+ * the cost per call and the heap allocations made from process().
+ *
+ * Built from the plugin's sources against the Rack SDK, see
+ * `make module-host`. The widgets are linked in but never created, so
+ * nothing needs a window or Rack's engine. The exit code is 1 when a
+ * module goes over --max-ns or --max-allocs, so it can gate a merge.
+ *
+ * Allocations are only counted on the thread calling process(), the
+ * WorkerPool jobs (BufferRebuilder, BufferExporter) allocate on purpose.
+ * The first second is reported separately since the first clock sizes
+ * the buffers.
+ *
+ * SortStep is also saved past what its streamed event log keeps and
+ * loaded again, which fails the run when the loaded sort never ends.
+ */
+
+#include "BufferSludger.hpp"
+#include "BufferSludgerTransposer.hpp"
+#include "DressMeUp.hpp"
+#include "SortStep.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Only the process() calls of the audio thread are counted
+static thread_local bool countAllocations = false;
+static thread_local size_t allocationCount = 0;
+static thread_local size_t allocationBytes = 0;
+
+void *operator new(size_t size)
+{
+	if (countAllocations)
+	{
+		++allocationCount;
+		allocationBytes += size;
+	}
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+enum Shape
+{
+	SHAPE_CONST,
+	SHAPE_SINE,
+	SHAPE_SAW, // 0 to amp
+	SHAPE_CLOCK, // 10V pulses, the rate is swept by depth at sweep Hz
+	SHAPE_NOISE
+};
+
+/** One scripted input, poly channels are spread in phase */
+struct Signal
+{
+	int port;
+	Shape shape;
+	float freq;
+	float amp;
+	int channels;
+	float depth;
+	float sweep;
+
+	double phase = 0.0;
+	double sweepPhase = 0.0;
+	uint32_t noise = 22222u;
+
+	Signal(int port, Shape shape, float freq, float amp, int channels = 1, float depth = 0.f, float sweep = 0.f)
+		: port(port), shape(shape), freq(freq), amp(amp), channels(channels), depth(depth), sweep(sweep) {}
+
+	void apply(Module *module, float sampleTime)
+	{
+		double rate = freq;
+		if (depth != 0.f)
+		{
+			sweepPhase += sweep * sampleTime;
+			sweepPhase -= std::floor(sweepPhase);
+			rate *= 1.0 + depth * std::sin(2.0 * M_PI * sweepPhase);
+		}
+		phase += rate * sampleTime;
+		phase -= std::floor(phase);
+
+		Input &input = module->inputs[port];
+		for (int c = 0; c < channels; ++c)
+		{
+			double p = phase + (double)c / channels;
+			p -= std::floor(p);
+			input.setVoltage(value(p), c);
+		}
+	}
+
+	float value(double p)
+	{
+		switch (shape)
+		{
+		case SHAPE_SINE:
+			return amp * std::sin(2.0 * M_PI * p);
+		case SHAPE_SAW:
+			return amp * p;
+		case SHAPE_CLOCK:
+			return p < 0.5 ? 10.f : 0.f;
+		case SHAPE_NOISE:
+			noise ^= noise << 13;
+			noise ^= noise >> 17;
+			noise ^= noise << 5;
+			return amp * ((noise & 0xffff) / 32768.f - 1.f);
+		default:
+			return amp;
+		}
+	}
+};
+
+struct Scenario
+{
+	std::string name;
+	Module *module;
+	// Processed alongside but not measured, like an expander's neighbour
+	Module *partner = NULL;
+	std::vector<Signal> signals;
+	std::vector<std::pair<int, float>> params;
+};
+
+static void connect(Module *module, std::vector<Signal> &signals)
+{
+	for (Signal &signal : signals)
+		module->inputs[signal.port].channels = signal.channels;
+}
+
+static std::vector<Scenario> makeScenarios()
+{
+	std::vector<Scenario> scenarios;
+
+	{
+		Scenario s;
+		s.name = "BufferSludger";
+		s.module = new BufferSludger();
+		s.params.push_back(std::make_pair((int)BufferSludger::EXTERNAL_BPM_PARAM, 1.f));
+		s.signals.push_back(Signal(BufferSludger::AUDIO_INPUT, SHAPE_SINE, 220.f, 5.f));
+		s.signals.push_back(Signal(BufferSludger::AUDIO_RIGHT_INPUT, SHAPE_SINE, 330.f, 5.f));
+		// 120 BPM swept by 10% so the tempo tracker resizes the buffer
+		s.signals.push_back(Signal(BufferSludger::STEP_INPUT, SHAPE_CLOCK, 2.f, 10.f, 1, 0.1f, 0.1f));
+		s.signals.push_back(Signal(BufferSludger::AUTOMATION_INPUT, SHAPE_SAW, 0.5f, 10.f));
+		scenarios.push_back(s);
+	}
+
+	{
+		Scenario s;
+		s.name = "BufferSludgerTransposer";
+		BufferSludger *sludger = new BufferSludger();
+		BufferSludgerTransposer *transposer = new BufferSludgerTransposer();
+		sludger->rightExpander.module = transposer;
+		transposer->leftExpander.module = sludger;
+		s.module = transposer;
+		s.partner = sludger;
+		s.signals.push_back(Signal(BufferSludgerTransposer::VOCT_INPUT, SHAPE_SINE, 0.2f, 1.f));
+		s.signals.push_back(Signal(BufferSludgerTransposer::REVERSE_INPUT, SHAPE_CLOCK, 0.25f, 10.f));
+		scenarios.push_back(s);
+	}
+
+	{
+		Scenario s;
+		s.name = "SortStep";
+		s.module = new SortStep();
+		s.signals.push_back(Signal(SortStep::STEP_INPUT, SHAPE_CLOCK, 16.f, 10.f));
+		s.signals.push_back(Signal(SortStep::ALGORITHM_INPUT, SHAPE_SAW, 0.05f, 10.f));
+		s.signals.push_back(Signal(SortStep::RANDOMIZE_INPUT, SHAPE_CLOCK, 0.25f, 10.f));
+		scenarios.push_back(s);
+	}
+
+	{
+		Scenario s;
+		s.name = "DressMeUp";
+		s.module = new DressMeUp();
+		s.signals.push_back(Signal(DressMeUp::CLOCKSTEP_INPUT, SHAPE_CLOCK, 4.f, 10.f));
+		s.signals.push_back(Signal(DressMeUp::STEPCV_INPUT, SHAPE_SAW, 0.1f, 10.f));
+		s.signals.push_back(Signal(DressMeUp::VALUEACV_INPUT, SHAPE_SINE, 1.f, 5.f));
+		s.signals.push_back(Signal(DressMeUp::VALUEBCV_INPUT, SHAPE_NOISE, 0.f, 5.f));
+		scenarios.push_back(s);
+	}
+
+	for (Scenario &s : scenarios)
+	{
+		connect(s.module, s.signals);
+		for (std::pair<int, float> &param : s.params)
+			s.module->params[param.first].setValue(param.second);
+	}
+	return scenarios;
+}
+
+struct Report
+{
+	double nsPerCall = 0.0;
+	double worstBlockNs = 0.0; // Per call, averaged over one block
+	size_t warmupAllocations = 0;
+	size_t allocations = 0;
+	size_t allocationBytes = 0;
+};
+
+static const int BLOCK_SIZE = 64;
+
+// What a steady_clock pair costs, taken off every measured call
+static double measureClockOverhead()
+{
+	double total = 0.0;
+	const int n = 100000;
+	for (int i = 0; i < n; ++i)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::nano>(end - start).count();
+	}
+	return total / n;
+}
+
+static Report run(Scenario &scenario, float sampleRate, float seconds, double clockOverhead)
+{
+	Report report;
+	Module::ProcessArgs args;
+	args.sampleRate = sampleRate;
+	args.sampleTime = 1.f / sampleRate;
+	args.frame = 0;
+
+	int64_t frames = (int64_t)(seconds * sampleRate);
+	int64_t warmupFrames = (int64_t)sampleRate;
+	double totalNs = 0.0;
+	int64_t measured = 0;
+
+	while (args.frame < frames)
+	{
+		bool warmup = args.frame < warmupFrames;
+		double blockNs = 0.0;
+		int n = 0;
+		for (; n < BLOCK_SIZE && args.frame < frames; ++n, ++args.frame)
+		{
+			for (Signal &signal : scenario.signals)
+				signal.apply(scenario.module, args.sampleTime);
+			if (scenario.partner)
+				scenario.partner->process(args);
+
+			allocationCount = 0;
+			allocationBytes = 0;
+			countAllocations = true;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			scenario.module->process(args);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			countAllocations = false;
+
+			blockNs += std::max(std::chrono::duration<double, std::nano>(end - start).count() - clockOverhead, 0.0);
+			if (warmup)
+				report.warmupAllocations += allocationCount;
+			else
+			{
+				report.allocations += allocationCount;
+				report.allocationBytes += allocationBytes;
+			}
+		}
+
+		if (!warmup)
+		{
+			totalNs += blockNs;
+			measured += n;
+			report.worstBlockNs = std::max(report.worstBlockNs, blockNs / n);
+		}
+	}
+
+	report.nsPerCall = measured > 0 ? totalNs / measured : 0.0;
+	return report;
+}
+
+// A SortStep saved past what a streamed log keeps, so the loaded sort
+// starts its worker at a cursor whose start it has to drop. False when the
+// loaded sort doesn't reach the end within timeoutSeconds
+static bool checkStreamedReload(float timeoutSeconds)
+{
+	SorterArray sorter;
+	sorter.changeAlgorithm(t_algorithmtype::CYCLE);
+	sorter.reset(1000);
+	sorter.waitForJob();
+	sorter.poll();
+	sorter.shuffle();
+	sorter.section = SECTION_STEP;
+
+	int cursor = (int)(SorterEventLog::STREAM_CHUNKS * SorterEventLog::CHUNK_SIZE) + 100000;
+	while (sorter.eventIndex < cursor && !sorter.isDoneSort())
+		sorter.stepSort();
+
+	json_t *rootJ = sorter.toJson();
+	SorterArray loaded;
+	loaded.fromJson(rootJ);
+	json_decref(rootJ);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (!loaded.isDoneSort())
+	{
+		loaded.stepSort();
+		if (std::chrono::steady_clock::now() - start > std::chrono::duration<float>(timeoutSeconds))
+			return false;
+	}
+	return std::is_sorted(loaded.array.begin(), loaded.array.end());
+}
+
+int main(int argc, char **argv)
+{
+	std::string only;
+	float sampleRate = 48000.f;
+	float seconds = 10.f;
+	double maxNs = 0.0;
+	long maxAllocations = -1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--module" && hasValue)
+			only = argv[++i];
+		else if (arg == "--sample-rate" && hasValue)
+			sampleRate = atof(argv[++i]);
+		else if (arg == "--seconds" && hasValue)
+			seconds = atof(argv[++i]);
+		else if (arg == "--max-ns" && hasValue)
+			maxNs = atof(argv[++i]);
+		else if (arg == "--max-allocs" && hasValue)
+			maxAllocations = atol(argv[++i]);
+		else
+		{
+			fprintf(stderr,
+				"usage: module-host [options]\n"
+				"  --module NAME     only this module\n"
+				"  --sample-rate N   default 48000\n"
+				"  --seconds N       simulated time per module, default 10\n"
+				"  --max-ns N        fail when a module averages more ns per process()\n"
+				"  --max-allocs N    fail when a module allocates more after the first second\n");
+			return 1;
+		}
+	}
+
+	if (seconds <= 1.f)
+	{
+		fprintf(stderr, "--seconds must be over the 1 second warm up\n");
+		return 1;
+	}
+
+	// The engine seeds every thread it processes modules on
+	random::init();
+
+	std::vector<Scenario> scenarios = makeScenarios();
+	double clockOverhead = measureClockOverhead();
+	bool failed = false;
+
+	printf("%-24s %10s %12s %10s %10s %12s\n", "module", "ns/call", "worst ns", "warmup", "allocs", "bytes");
+	for (Scenario &scenario : scenarios)
+	{
+		if (!only.empty() && only != scenario.name)
+			continue;
+
+		Report report = run(scenario, sampleRate, seconds, clockOverhead);
+		printf("%-24s %10.1f %12.1f %10zu %10zu %12zu\n", scenario.name.c_str(),
+			report.nsPerCall, report.worstBlockNs, report.warmupAllocations,
+			report.allocations, report.allocationBytes);
+
+		if (maxNs > 0.0 && report.nsPerCall > maxNs)
+		{
+			fprintf(stderr, "%s: %.1f ns per process() is over %.1f\n", scenario.name.c_str(), report.nsPerCall, maxNs);
+			failed = true;
+		}
+		if (maxAllocations >= 0 && (long)report.allocations > maxAllocations)
+		{
+			fprintf(stderr, "%s: %zu allocations in process() is over %ld\n", scenario.name.c_str(), report.allocations, maxAllocations);
+			failed = true;
+		}
+	}
+
+	if (only.empty() || only == "SortStep")
+	{
+		bool reloaded = checkStreamedReload(60.f);
+		printf("%-24s %s\n", "SortStep reload", reloaded ? "ok" : "failed");
+		if (!reloaded)
+		{
+			fprintf(stderr, "SortStep: a sort saved past the streamed log didn't finish after loading\n");
+			failed = true;
+		}
+	}
+
+	// Expanders first, they point at their neighbours
+	for (int i = (int)scenarios.size() - 1; i >= 0; --i)
+	{
+		delete scenarios[i].module;
+		delete scenarios[i].partner;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,295 @@
+/**
+ * Renders a wav through the BufferSludger DSP without Rack, as fast as
+ * the machine allows. Used to check changes to the engine offline and
+ * to reproduce a patch bit for bit.
+ *
+ * Audio is read and written at 5V full scale like the module's wav
+ * loader. CV streams are either a wav (full scale is 10V, one value per
+ * audio frame) or a text file with one value in volts per line (the
+ * first column of a csv). A stream shorter than the input holds its last
+ * value.
+ *
+ * Build with `make sludger-render`.
+ */
+
+#include "Globals.hpp"
+#include "SludgerEngine.hpp"
+#include "dr_wav.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const float CV_VOLTS = 10.0f;
+
+static void usage()
+{
+	fprintf(stderr,
+		"usage: sludger-render [options] in.wav out.wav\n"
+		"  --automation FILE   playback automation CV (wav or csv)\n"
+		"  --clock FILE        clock step CV, replaces the internal bpm\n"
+		"  --phase FILE        clock phase CV, replaces the internal bpm\n"
+		"  --bpm N             internal bpm, default 120\n"
+		"  --mode MODE         linear or derivative, default linear\n"
+		"  --interpolation M   none, linear, cubic, 2x, 8x or 32x, default 8x\n"
+		"  --mix N             dry/wet mix from 0 to 1, default 1\n"
+		"  --overdub N         overdub with feedback N\n"
+		"  --compact           store the buffer as int16\n");
+}
+
+static bool endsWith(const std::string &s, const std::string &suffix)
+{
+	return s.size() >= suffix.size() &&
+		s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Interleaved frames, returns false if the file can't be read
+static bool readWav(const std::string &path, std::vector<float> &frames, int &channels, int &sampleRate)
+{
+	drwav wav;
+	if (!drwav_init_file(&wav, path.c_str(), NULL))
+		return false;
+
+	channels = wav.channels;
+	sampleRate = wav.sampleRate;
+	frames.resize(wav.totalPCMFrameCount * wav.channels);
+	drwav_uint64 read = drwav_read_pcm_frames_f32(&wav, wav.totalPCMFrameCount, frames.data());
+	frames.resize(read * wav.channels);
+	drwav_uninit(&wav);
+	return true;
+}
+
+/** A CV input read from a file, first channel only */
+struct CvStream
+{
+	std::vector<float> values;
+	bool connected = false;
+
+	bool load(const std::string &path)
+	{
+		values.clear();
+		if (endsWith(path, ".wav") || endsWith(path, ".WAV"))
+		{
+			std::vector<float> frames;
+			int channels, sampleRate;
+			if (!readWav(path, frames, channels, sampleRate))
+				return false;
+			for (size_t i = 0; i < frames.size(); i += channels)
+				values.push_back(frames[i] * CV_VOLTS);
+		}
+		else
+		{
+			std::ifstream file(path);
+			if (!file)
+				return false;
+			std::string line;
+			while (std::getline(file, line))
+			{
+				// Skips headers and empty lines
+				char *end;
+				float value = strtof(line.c_str(), &end);
+				if (end != line.c_str())
+					values.push_back(value);
+			}
+		}
+		connected = !values.empty();
+		return connected;
+	}
+
+	float at(size_t frame) const
+	{
+		if (values.empty())
+			return 0.0f;
+		return frame < values.size() ? values[frame] : values.back();
+	}
+};
+
+static int parseInterpolation(const std::string &name)
+{
+	if (name == "none")
+		return SludgerEngine::INTERPOLATION_MODE_NONE;
+	if (name == "linear")
+		return SludgerEngine::INTERPOLATION_MODE_LINEAR;
+	if (name == "cubic")
+		return SludgerEngine::INTERPOLATION_MODE_CUBIC;
+	if (name == "2x")
+		return SludgerEngine::INTERPOLATION_MODE_OPTIMAL_2X;
+	if (name == "8x")
+		return SludgerEngine::INTERPOLATION_MODE_OPTIMAL_8X;
+	if (name == "32x")
+		return SludgerEngine::INTERPOLATION_MODE_OPTIMAL_32X;
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	std::string inPath, outPath;
+	std::string automationPath, clockPath, phasePath;
+	float bpm = 120.0f;
+	float mix = 1.0f;
+	int automationMode = SludgerEngine::AUTOMATION_MODE_LINEAR;
+	int interpolationMode = SludgerEngine::INTERPOLATION_MODE_OPTIMAL_8X;
+	bool overdub = false;
+	float feedback = 0.8f;
+	bool compact = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--automation" && hasValue)
+			automationPath = argv[++i];
+		else if (arg == "--clock" && hasValue)
+			clockPath = argv[++i];
+		else if (arg == "--phase" && hasValue)
+			phasePath = argv[++i];
+		else if (arg == "--bpm" && hasValue)
+			bpm = atof(argv[++i]);
+		else if (arg == "--mix" && hasValue)
+			mix = atof(argv[++i]);
+		else if (arg == "--mode" && hasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "linear")
+				automationMode = SludgerEngine::AUTOMATION_MODE_LINEAR;
+			else if (mode == "derivative")
+				automationMode = SludgerEngine::AUTOMATION_MODE_DERIVATIVE;
+			else
+			{
+				usage();
+				return 1;
+			}
+		}
+		else if (arg == "--interpolation" && hasValue)
+		{
+			interpolationMode = parseInterpolation(argv[++i]);
+			if (interpolationMode < 0)
+			{
+				usage();
+				return 1;
+			}
+		}
+		else if (arg == "--overdub" && hasValue)
+		{
+			overdub = true;
+			feedback = atof(argv[++i]);
+		}
+		else if (arg == "--compact")
+			compact = true;
+		else if (arg[0] != '-' && inPath.empty())
+			inPath = arg;
+		else if (arg[0] != '-' && outPath.empty())
+			outPath = arg;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if (inPath.empty() || outPath.empty())
+	{
+		usage();
+		return 1;
+	}
+
+	std::vector<float> audio;
+	int channels, sampleRate;
+	if (!readWav(inPath, audio, channels, sampleRate) || channels < 1)
+	{
+		fprintf(stderr, "Can't read %s\n", inPath.c_str());
+		return 1;
+	}
+	size_t length = audio.size() / channels;
+	bool stereo = channels > 1;
+
+	CvStream automation, clock, phase;
+	if (!automationPath.empty() && !automation.load(automationPath))
+	{
+		fprintf(stderr, "Can't read %s\n", automationPath.c_str());
+		return 1;
+	}
+	if (!clockPath.empty() && !clock.load(clockPath))
+	{
+		fprintf(stderr, "Can't read %s\n", clockPath.c_str());
+		return 1;
+	}
+	if (!phasePath.empty() && !phase.load(phasePath))
+	{
+		fprintf(stderr, "Can't read %s\n", phasePath.c_str());
+		return 1;
+	}
+
+	// Heavy, holds the STFT state and the buffers
+	SludgerEngine *engine = new SludgerEngine();
+	engine->initialize();
+	engine->automationMode = automationMode;
+	engine->interpolationMode = interpolationMode;
+	engine->enableOverdub = overdub;
+	engine->overdubFeedback = feedback;
+	engine->compactStorage = compact;
+	// Converted when asked, not whenever a worker gets to it
+	engine->rebuilder.setSynchronous(true);
+
+	SludgerEngine::Input in;
+	in.sampleRate = sampleRate;
+	in.sampleTime = 1.0f / sampleRate;
+	in.audioConnected[0] = true;
+	in.audioConnected[1] = stereo;
+	in.externalBpm = clock.connected || phase.connected;
+	in.bpm = bpm;
+	in.stepConnected = clock.connected;
+	in.phaseConnected = phase.connected;
+	in.mix = mix;
+
+	int outChannels = stereo ? 2 : 1;
+	std::vector<float> rendered(length * outChannels);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t n = 0; n < length; ++n)
+	{
+		in.audio[0] = audio[n * channels] * AUDIO_VOLTS;
+		in.audio[1] = stereo ? audio[n * channels + 1] * AUDIO_VOLTS : 0.0f;
+		in.automation = automation.at(n);
+		in.step = clock.at(n);
+		in.phase = phase.at(n);
+
+		engine->process(in);
+
+		for (int c = 0; c < outChannels; ++c)
+			rendered[n * outChannels + c] = engine->filteredOutput[c] / AUDIO_VOLTS;
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	delete engine;
+
+	drwav_data_format format;
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+	format.channels = outChannels;
+	format.sampleRate = sampleRate;
+	format.bitsPerSample = 32;
+
+	drwav wav;
+	if (!drwav_init_file_write(&wav, outPath.c_str(), &format, NULL))
+	{
+		fprintf(stderr, "Can't write %s\n", outPath.c_str());
+		return 1;
+	}
+	drwav_uint64 written = drwav_write_pcm_frames(&wav, length, rendered.data());
+	drwav_uninit(&wav);
+	if (written != length)
+	{
+		fprintf(stderr, "Can't write %s\n", outPath.c_str());
+		return 1;
+	}
+
+	double seconds = (double)length / sampleRate;
+	fprintf(stderr, "Rendered %.2fs in %.3fs, %.1fx realtime\n",
+		seconds, elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0);
+	return 0;
+}